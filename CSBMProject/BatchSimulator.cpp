@@ -0,0 +1,298 @@
+#include "BatchSimulator.h"
+
+#include <cmath>
+#include <omp.h>
+
+#include "CpuFeatures.h"
+
+BatchSimulator::BatchSimulator(Configuration& config, SimulationInfo* simulations, int simulationCount, bool recording,
+	OutputWriter* outputWriter, SegmentedOutput* segments) : simulations(simulations), simulationCount(simulationCount), recording(recording),
+	outputWriter(outputWriter), segments(segments) {
+
+	kernel = selectKernel();
+	maximumDuration = config.getMaximumDuration();
+	outputFormat = config.getOutputFormat();
+	streaming = recording && config.getStreamOutput();
+
+	if (simulationCount > 0) {
+		vector<vector<int>> changes = simulations[0].recordedEventChanges();
+		for (int i = 0; i < SimulationInfo::ELEMENTARY_EVENT_COUNT; i++) {
+			for (int j = 0; j < TrajectoryLog::FIELD_COUNT; j++) {
+				eventChanges[i][j] = changes[i][j];
+			}
+			eventSearchDepths[i] = searchPosition(&simulations[0], i) + 1;
+		}
+	}
+}
+
+BatchSimulator::Kernel BatchSimulator::selectKernel() {
+	return cpuSupportsAvx2() ? &BatchSimulator::avx2Kernel : &BatchSimulator::scalarKernel;
+}
+
+string BatchSimulator::getKernelName() {
+	return selectKernel() == &BatchSimulator::scalarKernel ? "scalar" : "AVX2";
+}
+
+// Both kernels evaluate the chances in the same order as SimulationInfo, so a lane follows exactly the
+// trajectory the direct method produces for its simulation.
+void BatchSimulator::scalarKernel(Lanes& lanes) {
+	for (int lane = 0; lane < LANES; lane++) {
+		double chances[8];
+		chances[0] = lanes.mortalityRate[lane] * lanes.totalPopulation[lane] * lanes.demographyEnabled[lane];
+		chances[1] = lanes.mortalityRate[lane] * lanes.susceptible[lane] * lanes.demographyEnabled[lane];
+		chances[2] = lanes.incubationPeriod[lane] * lanes.exposed[lane] * lanes.sicknessEnabled[lane];
+		chances[3] = lanes.mortalityRate[lane] * lanes.infected[lane] * lanes.demographyEnabled[lane];
+		chances[4] = lanes.mortalityRate[lane] * lanes.recovered[lane] * lanes.demographyEnabled[lane];
+		chances[5] = lanes.infectionRate[lane] * lanes.susceptible[lane] * lanes.infected[lane] / lanes.totalPopulation[lane];
+		chances[6] = lanes.infectedMortalityRate[lane] * lanes.infected[lane] * lanes.demographyEnabled[lane];
+		chances[7] = lanes.recoveryRate[lane] * lanes.infected[lane];
+
+		double cumulative[8];
+		double total = 0;
+		for (int i = 0; i < 8; i++) {
+			total += chances[i];
+			cumulative[i] = total;
+		}
+
+		double target = lanes.uniforms[lane] * total;
+		double selected = 0;
+		for (int i = 0; i < 8; i++) {
+			selected += cumulative[i] <= target ? 1 : 0;
+		}
+
+		lanes.waitingTimes[lane] = lanes.unitExponentials[lane] / total;
+		lanes.selectedEvents[lane] = selected;
+	}
+}
+
+#ifdef CPU_FEATURES_X86
+AVX2_TARGET void BatchSimulator::avx2Kernel(Lanes& lanes) {
+	__m256d susceptible = _mm256_load_pd(lanes.susceptible);
+	__m256d exposed = _mm256_load_pd(lanes.exposed);
+	__m256d infected = _mm256_load_pd(lanes.infected);
+	__m256d recovered = _mm256_load_pd(lanes.recovered);
+	__m256d totalPopulation = _mm256_load_pd(lanes.totalPopulation);
+
+	__m256d mortalityRate = _mm256_load_pd(lanes.mortalityRate);
+	__m256d demographyEnabled = _mm256_load_pd(lanes.demographyEnabled);
+
+	__m256d chances[8];
+	chances[0] = _mm256_mul_pd(_mm256_mul_pd(mortalityRate, totalPopulation), demographyEnabled);
+	chances[1] = _mm256_mul_pd(_mm256_mul_pd(mortalityRate, susceptible), demographyEnabled);
+	chances[2] = _mm256_mul_pd(_mm256_mul_pd(_mm256_load_pd(lanes.incubationPeriod), exposed), _mm256_load_pd(lanes.sicknessEnabled));
+	chances[3] = _mm256_mul_pd(_mm256_mul_pd(mortalityRate, infected), demographyEnabled);
+	chances[4] = _mm256_mul_pd(_mm256_mul_pd(mortalityRate, recovered), demographyEnabled);
+	chances[5] = _mm256_div_pd(_mm256_mul_pd(_mm256_mul_pd(_mm256_load_pd(lanes.infectionRate), susceptible), infected), totalPopulation);
+	chances[6] = _mm256_mul_pd(_mm256_mul_pd(_mm256_load_pd(lanes.infectedMortalityRate), infected), demographyEnabled);
+	chances[7] = _mm256_mul_pd(_mm256_load_pd(lanes.recoveryRate), infected);
+
+	__m256d cumulative[8];
+	__m256d total = _mm256_setzero_pd();
+	for (int i = 0; i < 8; i++) {
+		total = _mm256_add_pd(total, chances[i]);
+		cumulative[i] = total;
+	}
+
+	__m256d target = _mm256_mul_pd(_mm256_load_pd(lanes.uniforms), total);
+	__m256d one = _mm256_set1_pd(1.0);
+	__m256d selected = _mm256_setzero_pd();
+	for (int i = 0; i < 8; i++) {
+		selected = _mm256_add_pd(selected, _mm256_and_pd(_mm256_cmp_pd(cumulative[i], target, _CMP_LE_OQ), one));
+	}
+
+	_mm256_store_pd(lanes.waitingTimes, _mm256_div_pd(_mm256_load_pd(lanes.unitExponentials), total));
+	_mm256_store_pd(lanes.selectedEvents, selected);
+}
+#else
+void BatchSimulator::avx2Kernel(Lanes& lanes) {
+	scalarKernel(lanes);
+}
+#endif
+
+void BatchSimulator::run() {
+
+	for (int lane = 0; lane < LANES; lane++) {
+		assignLane(lane);
+	}
+
+	while (true) {
+
+		bool anyActive = false;
+
+		// Draw the random numbers in the same order as the direct method: waiting time first, then the event.
+		for (int lane = 0; lane < LANES; lane++) {
+			if (laneSimulations[lane] != nullptr) {
+				lanes.unitExponentials[lane] = laneVariates[lane].nextUnitExponential();
+				lanes.uniforms[lane] = laneVariates[lane].nextUniform();
+				anyActive = true;
+			}
+		}
+
+		if (!anyActive) {
+			break;
+		}
+
+		kernel(lanes);
+
+		for (int lane = 0; lane < LANES; lane++) {
+			SimulationInfo* simulation = laneSimulations[lane];
+			if (simulation == nullptr) {
+				continue;
+			}
+
+			int selectedEvent = (int)lanes.selectedEvents[lane];
+
+			// Rounding can leave the target past the last cumulative chance; take the last possible event then.
+			if (selectedEvent == SimulationInfo::ELEMENTARY_EVENT_COUNT) {
+				selectedEvent = SimulationInfo::NO_EVENT;
+				for (int i = 0; i < SimulationInfo::ELEMENTARY_EVENT_COUNT; i++) {
+					if (simulation->elementaryEventChance(i) != 0) {
+						selectedEvent = i;
+					}
+				}
+			}
+
+			// Like the direct method, the step ends at an intervention falling before the next elementary event.
+			double nextTime = laneTimes[lane] + lanes.waitingTimes[lane];
+			if (nextTime > simulation->nextInterventionTime) {
+				laneTimes[lane] = simulation->applyScheduledInterventions();
+			}
+			else {
+				if (selectedEvent != SimulationInfo::NO_EVENT) {
+					applyEvent(simulation, selectedEvent);
+				}
+				laneTimes[lane] = nextTime;
+			}
+
+			simulation->checkEvents();
+			if (recording) {
+				simulation->saveIteration(laneTimes[lane]);
+			}
+			else {
+				simulation->trackIteration(laneTimes[lane]);
+			}
+
+			if (isFinished(lane)) {
+				if (recording) {
+					outputSimulation(simulation);
+				}
+				assignLane(lane);
+			}
+			else {
+				loadLane(lane);
+			}
+		}
+	}
+}
+
+void BatchSimulator::assignLane(int lane) {
+
+	while (nextSimulation < simulationCount) {
+		SimulationInfo* simulation = &simulations[nextSimulation++];
+
+		laneSimulations[lane] = simulation;
+		laneTimes[lane] = 0;
+		simulation->attachVariateBuffer(laneVariates[lane]);
+		simulation->setThreadID(omp_get_thread_num());
+		if (streaming) {
+			simulation->startStreaming(laneStreams[lane], outputFormat);
+		}
+		if (recording) {
+			simulation->saveIteration(0);
+		}
+		else {
+			simulation->trackIteration(0);
+		}
+
+		if (!isFinished(lane)) {
+			loadLane(lane);
+
+			lanes.mortalityRate[lane] = simulation->mortalityRate;
+			lanes.infectedMortalityRate[lane] = simulation->infectedMortalityRate;
+			lanes.recoveryRate[lane] = simulation->recoveryRate;
+			lanes.incubationPeriod[lane] = simulation->incubationPeriod;
+			lanes.infectionRate[lane] = simulation->infectionRate;
+
+			lanes.demographyEnabled[lane] = simulation->simulationType == Configuration::SimulationType::SEIR_simplified ? 0 : 1;
+			lanes.sicknessEnabled[lane] = simulation->simulationType == Configuration::SimulationType::SIR ? 0 : 1;
+			return;
+		}
+
+		if (recording) {
+			outputSimulation(simulation);
+		}
+	}
+
+	// No simulations left: mask the lane out, keeping harmless values for the kernel.
+	laneSimulations[lane] = nullptr;
+	lanes.susceptible[lane] = lanes.exposed[lane] = lanes.infected[lane] = lanes.recovered[lane] = 0;
+	lanes.totalPopulation[lane] = 1;
+}
+
+void BatchSimulator::outputSimulation(SimulationInfo* simulation) {
+	simulation->finishRecording();
+
+	if (outputWriter != nullptr) {
+		outputWriter->submit(simulation);
+		return;
+	}
+
+	simulation->outputToFile(outputFormat, segments);
+	simulation->releaseRecords();
+}
+
+// Same changes as SimulationInfo::processOccurred, from the tables of the group.
+void BatchSimulator::applyEvent(SimulationInfo* simulation, int elementaryEvent) {
+	const int* changes = eventChanges[elementaryEvent];
+
+	simulation->susceptible += changes[0];
+	simulation->exposed += changes[1];
+	simulation->infected += changes[2];
+	simulation->recovered += changes[3];
+	simulation->totalPopulation += changes[4];
+
+	simulation->births += changes[TrajectoryLog::BIRTHS];
+	simulation->diedS += changes[TrajectoryLog::DEATHS_OF_SUSCEPTIBLE];
+	simulation->diedI += changes[TrajectoryLog::DEATHS_OF_INFECTED];
+	simulation->diedR += changes[TrajectoryLog::DEATHS_OF_RECOVERED];
+	simulation->diedDueToI += changes[TrajectoryLog::DEATHS_DUE_TO_INFECTION];
+	simulation->deathsTotal += changes[TrajectoryLog::DEATHS_TOTAL];
+
+	simulation->firingCounts[elementaryEvent]++;
+	simulation->searchDepth += eventSearchDepths[elementaryEvent];
+	simulation->lastEvent = elementaryEvent;
+}
+
+void BatchSimulator::loadLane(int lane) {
+	SimulationInfo* simulation = laneSimulations[lane];
+
+	lanes.susceptible[lane] = simulation->susceptible;
+	lanes.exposed[lane] = simulation->exposed;
+	lanes.infected[lane] = simulation->infected;
+	lanes.recovered[lane] = simulation->recovered;
+	lanes.totalPopulation[lane] = simulation->totalPopulation;
+}
+
+int BatchSimulator::searchPosition(SimulationInfo* simulation, int elementaryEvent) {
+
+	// Position of the event in the search of the specialized direct method, so the mean search depth matches it.
+	switch (simulation->simulationType) {
+	case Configuration::SimulationType::SIR:
+		return elementaryEvent > SimulationInfo::SICKNESS ? elementaryEvent - 1 : elementaryEvent;
+	case Configuration::SimulationType::SEIR:
+		return elementaryEvent;
+	default:
+		return elementaryEvent == SimulationInfo::SICKNESS ? 0 : elementaryEvent == SimulationInfo::INFECTION ? 1 : 2;
+	}
+}
+
+bool BatchSimulator::isFinished(int lane) {
+	SimulationInfo* simulation = laneSimulations[lane];
+	double time = laneTimes[lane];
+
+	// Same stopping rules as the simulation loop in Simulator::simulate.
+	if (simulation->getInfectousCount() <= 0 || time > 730) {
+		return true;
+	}
+	return maximumDuration != 0 && time >= maximumDuration;
+}
@@ -0,0 +1,105 @@
+#ifndef _BATCHSIMULATOR_H_
+
+#define _BATCHSIMULATOR_H_
+
+#include <vector>
+#include <string>
+#include <fstream>
+
+#include "Configuration.h"
+#include "SimulationInfo.h"
+#include "OutputWriter.h"
+
+using namespace std;
+
+// Runs a group of simulations with the direct method, LANES trajectories in lockstep.
+// The populations and parameters of the running trajectories are kept in structure-of-arrays form, so the
+// chances, their cumulative sums, the waiting times and the event selection are computed for all lanes at
+// once. The kernel is chosen at runtime: AVX2 when the CPU supports it, portable scalar code otherwise.
+// A lane whose trajectory ended is refilled with the next simulation of the group, and masked out once
+// the group runs dry.
+class BatchSimulator {
+
+public:
+
+	static const int LANES = 4;
+
+	// Constructor. Without recording, the iterations are neither saved nor output (used by the benchmarks).
+	// With an output writer, the finished simulations are handed to it instead of being output right away. With
+	// segments, the trajectories are appended to the segment files.
+	BatchSimulator(Configuration& config, SimulationInfo* simulations, int simulationCount, bool recording = true,
+		OutputWriter* outputWriter = nullptr, SegmentedOutput* segments = nullptr);
+
+	// Runs all simulations of the group to their end and outputs each of them to a file.
+	void run();
+
+	// Name of the kernel selected for this CPU.
+	static string getKernelName();
+
+private:
+
+	// Structure-of-arrays state of the lanes. The enabled factors are 1 or 0 depending on the simulation type.
+	struct Lanes {
+		alignas(32) double susceptible[LANES];
+		alignas(32) double exposed[LANES];
+		alignas(32) double infected[LANES];
+		alignas(32) double recovered[LANES];
+		alignas(32) double totalPopulation[LANES];
+
+		alignas(32) double mortalityRate[LANES];
+		alignas(32) double infectedMortalityRate[LANES];
+		alignas(32) double recoveryRate[LANES];
+		alignas(32) double incubationPeriod[LANES];
+		alignas(32) double infectionRate[LANES];
+
+		alignas(32) double demographyEnabled[LANES];
+		alignas(32) double sicknessEnabled[LANES];
+
+		alignas(32) double unitExponentials[LANES];
+		alignas(32) double uniforms[LANES];
+
+		alignas(32) double waitingTimes[LANES];
+		alignas(32) double selectedEvents[LANES];
+	};
+
+	typedef void (*Kernel)(Lanes& lanes);
+
+	static void scalarKernel(Lanes& lanes);
+	static void avx2Kernel(Lanes& lanes);
+	static Kernel selectKernel();
+
+	// Private helper functions.
+	void assignLane(int lane);
+	void loadLane(int lane);
+	bool isFinished(int lane);
+	void outputSimulation(SimulationInfo* simulation);
+	void applyEvent(SimulationInfo* simulation, int elementaryEvent);
+	static int searchPosition(SimulationInfo* simulation, int elementaryEvent);
+
+	Kernel kernel;
+	Lanes lanes;
+
+	// Changes of the fields of a simulation (in the order of TrajectoryLog) and search depth of every elementary
+	// event. All simulations of a group have the same type, so the events are applied from these tables without
+	// branching on the event.
+	int eventChanges[SimulationInfo::ELEMENTARY_EVENT_COUNT][TrajectoryLog::FIELD_COUNT];
+	int eventSearchDepths[SimulationInfo::ELEMENTARY_EVENT_COUNT];
+
+	SimulationInfo* simulations;
+	int simulationCount;
+	int nextSimulation = 0;
+
+	SimulationInfo* laneSimulations[LANES];
+	VariateBuffer laneVariates[LANES];
+	OutputStream laneStreams[LANES];
+	double laneTimes[LANES];
+
+	double maximumDuration;
+	string outputFormat;
+	bool recording;
+	bool streaming;
+	OutputWriter* outputWriter;
+	SegmentedOutput* segments;
+};
+
+#endif
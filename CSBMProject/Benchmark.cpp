@@ -0,0 +1,267 @@
+#include "Benchmark.h"
+#include "SimulationInfo.h"
+#include "NetworkSimulation.h"
+#include "BatchSimulator.h"
+#include "OutputStream.h"
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+#include <omp.h>
+
+void Benchmark::run() {
+	benchmarkDirectKernels();
+	benchmarkVariates();
+	benchmarkCompression();
+}
+
+void Benchmark::benchmarkDirectKernels() {
+
+	cout << "Direct method kernels " << endl << "-------------------" << endl;
+	cout << "| Type            | Generic (ns/event) | Specialized (ns/event) | Speedup | Reaction table (ns/event) | Batch (ns/event) |" << endl;
+
+	const Configuration::SimulationType types[] = {
+		Configuration::SimulationType::SIR,
+		Configuration::SimulationType::SEIR,
+		Configuration::SimulationType::SEIR_simplified
+	};
+	const string typeNames[] = { "SIR", "SEIR", "SEIR_simplified" };
+
+	for (int i = 0; i < 3; i++) {
+		double generic = measureDirectKernel(types[i], false);
+		double specialized = measureDirectKernel(types[i], true);
+		double network = measureNetworkKernel(types[i]);
+		double batch = measureBatchKernel(types[i]);
+
+		cout << "|" << setw(17) << left << typeNames[i] << "|";
+		cout << setw(20) << left << fixed << setprecision(2) << generic << "|";
+		cout << setw(24) << left << specialized << "|";
+		cout << setw(9) << left << generic / specialized << "|";
+		cout << setw(27) << left << network << "|";
+		cout << setw(18) << left << batch << "|" << endl;
+	}
+
+	cout << "Reaction table: the Network engine (Custom models only) on the type written as a reaction network" << endl;
+	cout << "Batch kernel: " << BatchSimulator::getKernelName() << ", " << BatchSimulator::LANES << " lanes" << endl;
+	cout << endl;
+}
+
+double Benchmark::measureDirectKernel(Configuration::SimulationType type, bool specialized) {
+
+	Configuration benchmarkConfig = config;
+	benchmarkConfig.setType(type);
+	benchmarkConfig.setEngine(Configuration::SimulationEngine::DIRECT);
+
+	vector<SimulationInfo> simulations;
+	for (int i = 0; i < SIMULATION_COUNT; i++) {
+		simulations.push_back(SimulationInfo(benchmarkConfig, FIRST_SIMULATION_ID + i));
+		if (!specialized) {
+			simulations.back().useGenericKernel();
+		}
+	}
+
+	// Run every simulation to its end without recording, so only the kernel is measured.
+	VariateBuffer variates;
+	auto startTime = std::chrono::steady_clock::now();
+	for (SimulationInfo& simulation : simulations) {
+		double currentTime = 0;
+		simulation.attachVariateBuffer(variates);
+		while (simulation.getInfectousCount() > 0 && currentTime <= 730) {
+			currentTime = simulation.performStep(currentTime);
+			simulation.checkEvents();
+		}
+	}
+	auto endTime = std::chrono::steady_clock::now();
+
+	long long events = 0;
+	for (SimulationInfo& simulation : simulations) {
+		for (int i = 0; i < SimulationInfo::getElementaryEventCount(); i++) {
+			events += simulation.getFiringCount(i);
+		}
+	}
+
+	double elapsedNanoseconds = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count();
+	return events > 0 ? elapsedNanoseconds / events : 0;
+}
+
+double Benchmark::measureNetworkKernel(Configuration::SimulationType type) {
+
+	Configuration benchmarkConfig = config;
+	benchmarkConfig.setType(type);
+	benchmarkConfig.buildTypeNetwork();
+
+	const ReactionNetwork* network = &benchmarkConfig.getNetwork();
+
+	vector<NetworkSimulation> simulations;
+	for (int i = 0; i < SIMULATION_COUNT; i++) {
+		simulations.push_back(NetworkSimulation(benchmarkConfig, network, FIRST_SIMULATION_ID + i));
+	}
+
+	auto startTime = std::chrono::steady_clock::now();
+	for (NetworkSimulation& simulation : simulations) {
+		double currentTime = 0;
+		while (simulation.getInfectousCount() > 0 && currentTime <= 730) {
+			currentTime = simulation.performStep(currentTime);
+		}
+	}
+	auto endTime = std::chrono::steady_clock::now();
+
+	long long events = 0;
+	for (NetworkSimulation& simulation : simulations) {
+		for (int i = 0; i < network->getReactionCount(); i++) {
+			events += simulation.getFiringCount(i);
+		}
+	}
+
+	double elapsedNanoseconds = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count();
+	return events > 0 ? elapsedNanoseconds / events : 0;
+}
+
+double Benchmark::measureBatchKernel(Configuration::SimulationType type) {
+
+	Configuration benchmarkConfig = config;
+	benchmarkConfig.setType(type);
+	benchmarkConfig.setEngine(Configuration::SimulationEngine::BATCH);
+
+	vector<SimulationInfo> simulations;
+	for (int i = 0; i < SIMULATION_COUNT; i++) {
+		simulations.push_back(SimulationInfo(benchmarkConfig, FIRST_SIMULATION_ID + i));
+	}
+
+	// The maximum duration of the configuration is ignored, like in the other measurements.
+	benchmarkConfig.setMaximumDuration(0);
+
+	auto startTime = std::chrono::steady_clock::now();
+	BatchSimulator batchSimulator(benchmarkConfig, simulations.data(), (int)simulations.size(), false);
+	batchSimulator.run();
+	auto endTime = std::chrono::steady_clock::now();
+
+	long long events = 0;
+	for (SimulationInfo& simulation : simulations) {
+		for (int i = 0; i < SimulationInfo::getElementaryEventCount(); i++) {
+			events += simulation.getFiringCount(i);
+		}
+	}
+
+	double elapsedNanoseconds = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count();
+	return events > 0 ? elapsedNanoseconds / events : 0;
+}
+
+void Benchmark::benchmarkVariates() {
+
+	cout << "Random variates (one exponential and one uniform per step) " << endl << "-------------------" << endl;
+
+	// The rate changes every step, like the total chance of a simulation does.
+	RandomGenerator rng(config.getSeed(), 0);
+	double sum = 0;
+
+	auto startTime = std::chrono::steady_clock::now();
+	for (int i = 0; i < VARIATE_COUNT; i++) {
+		sum += rng.nextExponential(1.0 + (i & 7)) + rng.nextUniform();
+	}
+	auto endTime = std::chrono::steady_clock::now();
+	double direct = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count() / VARIATE_COUNT;
+
+	RandomGenerator bufferedRng(config.getSeed(), 0);
+	VariateBuffer variates;
+	variates.attach(bufferedRng);
+
+	startTime = std::chrono::steady_clock::now();
+	for (int i = 0; i < VARIATE_COUNT; i++) {
+		sum += variates.nextUnitExponential() / (1.0 + (i & 7)) + variates.nextUniform();
+	}
+	endTime = std::chrono::steady_clock::now();
+	double buffered = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count() / VARIATE_COUNT;
+
+	cout << "| Generator (ns/step) | Buffer (ns/step) | Speedup |" << endl;
+	cout << "|" << setw(21) << left << fixed << setprecision(2) << direct << "|";
+	cout << setw(18) << left << buffered << "|";
+	cout << setw(9) << left << direct / buffered << "|" << endl;
+
+	// Printed so the compiler cannot drop the loops.
+	cout << "Buffer kernel: " << VariateBuffer::getKernelName() << endl;
+	cout << "Checksum: " << sum << endl << endl;
+}
+
+void Benchmark::benchmarkCompression() {
+
+	int threadCount = config.GetThreadCount();
+
+	cout << "Output compression (CSV trajectories, " << threadCount << " threads) " << endl << "-------------------" << endl;
+
+	Configuration benchmarkConfig = config;
+	benchmarkConfig.setEngine(Configuration::SimulationEngine::DIRECT);
+	benchmarkConfig.setOutputFormat("csv");
+
+	// Record a set of simulations and format their trajectories like the output files.
+	vector<string> trajectories;
+	size_t totalSize = 0;
+	VariateBuffer variates;
+
+	for (int i = 0; i < RECORDED_SIMULATION_COUNT; i++) {
+		SimulationInfo simulation(benchmarkConfig, FIRST_SIMULATION_ID + i);
+		simulation.attachVariateBuffer(variates);
+
+		double currentTime = 0;
+		simulation.saveIteration(currentTime);
+		while (simulation.getInfectousCount() > 0 && currentTime <= 730) {
+			currentTime = simulation.performStep(currentTime);
+			simulation.checkEvents();
+			simulation.saveIteration(currentTime);
+		}
+		simulation.finishRecording();
+
+		ostringstream trajectory;
+		simulation.outputTrajectory(trajectory, "csv");
+		trajectories.push_back(trajectory.str());
+		totalSize += trajectories.back().size();
+	}
+
+	const Configuration::OutputCompression compressions[] = {
+		Configuration::OutputCompression::NO_COMPRESSION,
+		Configuration::OutputCompression::GZIP,
+		Configuration::OutputCompression::ZSTD
+	};
+	const string compressionNames[] = { "None", "Gzip", "Zstd" };
+
+	cout << "| Compression | Throughput (MB/s) | Ratio  |" << endl;
+
+	for (int c = 0; c < 3; c++) {
+		if (!OutputStream::isAvailable(compressions[c])) {
+			cout << "|" << setw(13) << left << compressionNames[c] << "| not available in this build |" << endl;
+			continue;
+		}
+
+		// Every thread compresses whole trajectories, like the output threads do. The configured level is only
+		// validated for the configured compression, so it is limited to the range of each measured one.
+		int level = min(config.getCompressionLevel(), OutputStream::getMaximumLevel(compressions[c]));
+		vector<size_t> compressedSizes(trajectories.size());
+
+		auto startTime = std::chrono::steady_clock::now();
+#pragma omp parallel for schedule(dynamic) num_threads(threadCount)
+		for (int i = 0; i < (int)trajectories.size(); i++) {
+			ostringstream compressed;
+			OutputStream stream;
+			stream.attach(compressed, compressions[c], level);
+			stream.write(trajectories[i].data(), trajectories[i].size());
+			stream.close();
+			compressedSizes[i] = compressed.str().size();
+		}
+		auto endTime = std::chrono::steady_clock::now();
+
+		size_t compressedTotal = 0;
+		for (size_t size : compressedSizes) {
+			compressedTotal += size;
+		}
+
+		double elapsedSeconds = std::chrono::duration_cast<std::chrono::duration<double>>(endTime - startTime).count();
+		cout << "|" << setw(13) << left << compressionNames[c] << "|";
+		cout << setw(19) << left << fixed << setprecision(2) << (elapsedSeconds > 0 ? totalSize / elapsedSeconds / 1e6 : 0) << "|";
+		cout << setw(8) << left << (compressedTotal > 0 ? (double)totalSize / compressedTotal : 0) << "|" << endl;
+	}
+
+	cout << "Uncompressed size: " << totalSize / 1e6 << " MB" << endl << endl;
+}
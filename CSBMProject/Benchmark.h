@@ -0,0 +1,35 @@
+#ifndef _BENCHMARK_H_
+
+#define _BENCHMARK_H_
+
+#include "Configuration.h"
+
+class Benchmark {
+
+public:
+
+	Benchmark(Configuration& conf) : config(conf) {}
+
+	// Runs all benchmarks and prints the results to the standard output.
+	void run();
+
+private:
+
+	// Private helper functions.
+	void benchmarkDirectKernels();
+	void benchmarkVariates();
+	void benchmarkCompression();
+	double measureDirectKernel(Configuration::SimulationType type, bool specialized);
+	double measureNetworkKernel(Configuration::SimulationType type);
+	double measureBatchKernel(Configuration::SimulationType type);
+
+	Configuration config;
+
+	// Every measurement runs the simulations with the same IDs, so they all draw the same seeds and parameters.
+	static const int FIRST_SIMULATION_ID = 0;
+	static const int SIMULATION_COUNT = 20000;
+	static const int VARIATE_COUNT = 20000000;
+	static const int RECORDED_SIMULATION_COUNT = 2000;
+};
+
+#endif
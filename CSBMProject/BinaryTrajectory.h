@@ -0,0 +1,80 @@
+#ifndef _BINARYTRAJECTORY_H_
+
+#define _BINARYTRAJECTORY_H_
+
+#include <cstdint>
+
+// Layout of the trajectory files of the "bin" output type.
+// The file starts with a BinaryTrajectoryHeader, followed by one contiguous column per RecordedData field: the
+// timestamps as doubles, then the populations and counters as 32-bit integers, all little-endian. Every column
+// starts at a multiple of COLUMN_ALIGNMENT bytes from the start of the file, so a mapped file can be read in
+// place (see BinaryTrajectoryReader.h).
+namespace BinaryTrajectory {
+
+	static const char MAGIC[8] = { 'C', 'S', 'B', 'M', 'B', 'I', 'N', '1' };
+
+	// Written as a native integer; reads back differently on a host of the other byte order.
+	static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+	static const uint64_t COLUMN_ALIGNMENT = 64;
+
+	// Columns in file order.
+	enum Column {
+		TIMESTAMP,
+		SUSCEPTIBLE,
+		EXPOSED,
+		INFECTED,
+		RECOVERED,
+		TOTAL,
+		BIRTHS,
+		DEATHS_OF_SUSCEPTIBLE,
+		DEATHS_OF_INFECTED,
+		DEATHS_OF_RECOVERED,
+		DEATHS_DUE_TO_INFECTION,
+		DEATHS_TOTAL,
+		COLUMN_COUNT
+	};
+
+	// Rate parameters in file order.
+	enum Parameter {
+		MORTALITY_RATE,
+		INFECTED_MORTALITY_RATE,
+		RECOVERY_RATE,
+		INCUBATION_PERIOD,
+		INFECTION_RATE,
+		PARAMETER_COUNT
+	};
+
+	// Bits of the active event mask.
+	enum Event {
+		VACCINATION = 1,
+		REVACCINATION = 2
+	};
+
+	inline uint64_t columnElementSize(int column) {
+		return column == TIMESTAMP ? sizeof(double) : sizeof(int32_t);
+	}
+
+	inline uint64_t alignColumn(uint64_t offset) {
+		return (offset + COLUMN_ALIGNMENT - 1) / COLUMN_ALIGNMENT * COLUMN_ALIGNMENT;
+	}
+}
+
+struct BinaryTrajectoryHeader {
+	char magic[8];
+	uint32_t byteOrder;
+	uint32_t headerSize;
+	int32_t simulationID;
+	// Configuration::SimulationType.
+	int32_t simulationType;
+	uint32_t activeEvents;
+	uint32_t columnCount;
+	uint64_t recordCount;
+	double parameters[BinaryTrajectory::PARAMETER_COUNT];
+	// Offsets of the columns from the start of the file.
+	uint64_t columnOffsets[BinaryTrajectory::COLUMN_COUNT];
+};
+
+static_assert(sizeof(BinaryTrajectoryHeader) == 176, "The trajectory file header must not contain padding.");
+
+#endif
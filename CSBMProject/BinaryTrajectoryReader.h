@@ -0,0 +1,177 @@
+#ifndef _BINARYTRAJECTORYREADER_H_
+
+#define _BINARYTRAJECTORYREADER_H_
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "BinaryTrajectory.h"
+
+// Reads a trajectory file of the "bin" output type by mapping it into memory. The columns are returned as
+// pointers into the mapping, so nothing is copied or parsed:
+//
+//	BinaryTrajectoryReader reader;
+//	if (reader.open("output_files/output_simulation_0.bin")) {
+//		const double* time = reader.timestamps();
+//		const int32_t* infected = reader.column(BinaryTrajectory::INFECTED);
+//		for (uint64_t i = 0; i < reader.size(); i++) { ... }
+//	}
+class BinaryTrajectoryReader {
+
+public:
+
+	BinaryTrajectoryReader() {}
+	~BinaryTrajectoryReader() { close(); }
+
+	BinaryTrajectoryReader(const BinaryTrajectoryReader&) = delete;
+	BinaryTrajectoryReader& operator=(const BinaryTrajectoryReader&) = delete;
+
+	// Maps the file and checks the header of the trajectory starting at the given offset (nonzero for a trajectory
+	// in a segment file of a consolidated output, see SegmentedOutput.h). Returns false if the file cannot be mapped
+	// or does not hold a valid trajectory there.
+	bool open(const std::string& filename, uint64_t offset = 0) {
+		close();
+
+		if (!map(filename)) {
+			return false;
+		}
+		if (offset > viewLength) {
+			close();
+			return false;
+		}
+		data = view + offset;
+		length = viewLength - (size_t)offset;
+
+		if (!valid()) {
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	void close() {
+		if (view == nullptr) {
+			return;
+		}
+#ifdef _WIN32
+		UnmapViewOfFile(view);
+		CloseHandle(mapping);
+		CloseHandle(file);
+#else
+		munmap((void*)view, viewLength);
+#endif
+		view = nullptr;
+		viewLength = 0;
+		data = nullptr;
+		length = 0;
+	}
+
+	// Getter methods.
+	const BinaryTrajectoryHeader& header() const { return *(const BinaryTrajectoryHeader*)data; }
+	uint64_t size() const { return header().recordCount; }
+
+	// Columns. All columns but the timestamps hold 32-bit integers.
+	const double* timestamps() const { return (const double*)(data + header().columnOffsets[BinaryTrajectory::TIMESTAMP]); }
+	const int32_t* column(int column) const { return (const int32_t*)(data + header().columnOffsets[column]); }
+
+private:
+
+	bool map(const std::string& filename) {
+#ifdef _WIN32
+		file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+			CloseHandle(file);
+			return false;
+		}
+
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping == NULL) {
+			CloseHandle(file);
+			return false;
+		}
+
+		view = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (view == nullptr) {
+			CloseHandle(mapping);
+			CloseHandle(file);
+			return false;
+		}
+		viewLength = (size_t)fileSize.QuadPart;
+		return true;
+#else
+		int descriptor = ::open(filename.c_str(), O_RDONLY);
+		if (descriptor < 0) {
+			return false;
+		}
+
+		struct stat status;
+		if (fstat(descriptor, &status) != 0 || status.st_size == 0) {
+			::close(descriptor);
+			return false;
+		}
+
+		void* mapped = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+		::close(descriptor);
+		if (mapped == MAP_FAILED) {
+			return false;
+		}
+
+		view = (const uint8_t*)mapped;
+		viewLength = (size_t)status.st_size;
+		return true;
+#endif
+	}
+
+	bool valid() const {
+		if (length < sizeof(BinaryTrajectoryHeader)) {
+			return false;
+		}
+
+		const BinaryTrajectoryHeader& fileHeader = header();
+		if (memcmp(fileHeader.magic, BinaryTrajectory::MAGIC, sizeof(fileHeader.magic)) != 0 ||
+			fileHeader.byteOrder != BinaryTrajectory::BYTE_ORDER_MARK ||
+			fileHeader.headerSize != sizeof(BinaryTrajectoryHeader) ||
+			fileHeader.columnCount != BinaryTrajectory::COLUMN_COUNT) {
+			return false;
+		}
+
+		for (int i = 0; i < BinaryTrajectory::COLUMN_COUNT; i++) {
+			uint64_t offset = fileHeader.columnOffsets[i];
+			if (offset % BinaryTrajectory::COLUMN_ALIGNMENT != 0 || offset > length ||
+				fileHeader.recordCount > (length - offset) / BinaryTrajectory::columnElementSize(i)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// The whole mapped file, and the trajectory in it.
+	const uint8_t* view = nullptr;
+	size_t viewLength = 0;
+	const uint8_t* data = nullptr;
+	size_t length = 0;
+
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = NULL;
+#endif
+};
+
+#endif
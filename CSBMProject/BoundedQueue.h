@@ -0,0 +1,109 @@
+#ifndef _BOUNDEDQUEUE_H_
+
+#define _BOUNDEDQUEUE_H_
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+
+using namespace std;
+
+// A bounded lock-free queue for any number of producers and consumers (Vyukov's array-based queue).
+// Every cell carries a sequence number telling whether it is ready to be written or read in the current lap,
+// so producers and consumers only contend on their own position counter. The capacity is rounded up to a power
+// of two. tryPush and tryPop never block; callers decide how to wait.
+template <typename T>
+class BoundedQueue {
+
+public:
+
+	// Constructor.
+	BoundedQueue(size_t requestedCapacity) {
+		capacity = 1;
+		while (capacity < requestedCapacity) {
+			capacity *= 2;
+		}
+		mask = capacity - 1;
+
+		cells.reset(new Cell[capacity]);
+		for (size_t i = 0; i < capacity; i++) {
+			cells[i].sequence.store(i, memory_order_relaxed);
+		}
+	}
+
+	// Appends the value. Returns false if the queue is full.
+	bool tryPush(const T& value) {
+		size_t position = enqueuePosition.load(memory_order_relaxed);
+
+		while (true) {
+			Cell& cell = cells[position & mask];
+			size_t sequence = cell.sequence.load(memory_order_acquire);
+			ptrdiff_t difference = (ptrdiff_t)sequence - (ptrdiff_t)position;
+
+			if (difference == 0) {
+				if (enqueuePosition.compare_exchange_weak(position, position + 1, memory_order_relaxed)) {
+					cell.value = value;
+					cell.sequence.store(position + 1, memory_order_release);
+					return true;
+				}
+			}
+			else if (difference < 0) {
+				return false;
+			}
+			else {
+				position = enqueuePosition.load(memory_order_relaxed);
+			}
+		}
+	}
+
+	// Removes the oldest value. Returns false if the queue is empty.
+	bool tryPop(T& value) {
+		size_t position = dequeuePosition.load(memory_order_relaxed);
+
+		while (true) {
+			Cell& cell = cells[position & mask];
+			size_t sequence = cell.sequence.load(memory_order_acquire);
+			ptrdiff_t difference = (ptrdiff_t)sequence - (ptrdiff_t)(position + 1);
+
+			if (difference == 0) {
+				if (dequeuePosition.compare_exchange_weak(position, position + 1, memory_order_relaxed)) {
+					value = cell.value;
+					cell.sequence.store(position + mask + 1, memory_order_release);
+					return true;
+				}
+			}
+			else if (difference < 0) {
+				return false;
+			}
+			else {
+				position = dequeuePosition.load(memory_order_relaxed);
+			}
+		}
+	}
+
+	// Number of values in the queue (approximate while other threads push or pop).
+	size_t size() const {
+		size_t enqueued = enqueuePosition.load(memory_order_relaxed);
+		size_t dequeued = dequeuePosition.load(memory_order_relaxed);
+		return enqueued > dequeued ? enqueued - dequeued : 0;
+	}
+
+	size_t getCapacity() const { return capacity; }
+
+private:
+
+	struct Cell {
+		atomic<size_t> sequence;
+		T value;
+	};
+
+	unique_ptr<Cell[]> cells;
+	size_t capacity;
+	size_t mask;
+
+	// The positions are kept on separate cache lines, so producers and consumers do not share one.
+	alignas(64) atomic<size_t> enqueuePosition{ 0 };
+	alignas(64) atomic<size_t> dequeuePosition{ 0 };
+};
+
+#endif
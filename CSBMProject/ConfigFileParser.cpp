@@ -1,5 +1,9 @@
 #include "ConfigFileParser.h"
+#include "OutputStream.h"
 #include <fstream>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
 
 using nlohmann::json;
 
@@ -23,21 +27,234 @@ void ConfigFileParser::parse() {
 	else if (configJson["general"]["SimulationType"] == "SEIR_simplified") {
 		config->setType(Configuration::SimulationType::SEIR_simplified);
 	}
+	else if (configJson["general"]["SimulationType"] == "Custom") {
+		config->setType(Configuration::SimulationType::CUSTOM);
+	}
 	else {
 		cerr << "ERROR: Invalid simulation type in config file." << endl;
 		exit(1);
 	}
 
+	// Parse engine. The direct method is used when no engine is given.
+	string engine = configJson["general"].value("Engine", string("Direct"));
+	if (engine == "Direct") {
+		config->setEngine(Configuration::SimulationEngine::DIRECT);
+	}
+	else if (engine == "IncrementalDirect") {
+		config->setEngine(Configuration::SimulationEngine::INCREMENTAL_DIRECT);
+	}
+	else if (engine == "ODM") {
+		config->setEngine(Configuration::SimulationEngine::OPTIMIZED_DIRECT);
+	}
+	else if (engine == "NRM") {
+		config->setEngine(Configuration::SimulationEngine::NEXT_REACTION);
+	}
+	else if (engine == "TauLeaping") {
+		config->setEngine(Configuration::SimulationEngine::TAU_LEAPING);
+	}
+	else if (engine == "Langevin") {
+		config->setEngine(Configuration::SimulationEngine::LANGEVIN);
+	}
+	else if (engine == "ODE") {
+		config->setEngine(Configuration::SimulationEngine::MEAN_FIELD);
+	}
+	else if (engine == "Network") {
+		config->setEngine(Configuration::SimulationEngine::REACTION_NETWORK);
+	}
+	else if (engine == "Batch") {
+		config->setEngine(Configuration::SimulationEngine::BATCH);
+	}
+	else {
+		cerr << "ERROR: Invalid simulation engine in config file." << endl;
+		exit(1);
+	}
+
+	// Custom models always run on the reaction network engine, and only they do: the built-in types run on their
+	// own engines, which support the interventions and outputs the reaction network engine does not.
+	if (config->getType() == Configuration::SimulationType::CUSTOM) {
+		if (engine != "Direct" && engine != "Network") {
+			cerr << "ERROR: Custom models can only be simulated with the Network engine." << endl;
+			exit(1);
+		}
+		config->setEngine(Configuration::SimulationEngine::REACTION_NETWORK);
+	}
+	else if (config->getEngine() == Configuration::SimulationEngine::REACTION_NETWORK) {
+		cerr << "ERROR: The Network engine only simulates Custom models." << endl;
+		exit(1);
+	}
+
 	// Parse output file type.
 
 	config->setOutputFormat(configJson["general"]["OutputType"]);
 
+	// The trajectory log and the binary files hold the fields of the built-in types only.
+	if ((config->getOutputFormat() == "log" || config->getOutputFormat() == "bin") &&
+		config->getEngine() == Configuration::SimulationEngine::REACTION_NETWORK) {
+		cerr << "ERROR: The log and bin output types are not available with the Network engine." << endl;
+		exit(1);
+	}
+
+	// Only the built-in types track the statistics of the summary output type.
+	if (config->getOutputFormat() == "summary" && config->getEngine() == Configuration::SimulationEngine::REACTION_NETWORK) {
+		cerr << "ERROR: The summary output type is not available with the Network engine." << endl;
+		exit(1);
+	}
+
+	// Parse the output mode. By default every simulation keeps its records until it ends.
+	config->setStreamOutput(configJson["general"].value("StreamOutput", false));
+
+	// The columns of a binary file can only be written once the number of records is known.
+	if (config->getOutputFormat() == "bin" && config->getStreamOutput()) {
+		cerr << "ERROR: The bin output type cannot be streamed." << endl;
+		exit(1);
+	}
+
+	// Parse the number of segment files. By default every simulation is written to a file of its own.
+	config->setOutputSegmentCount(configJson["general"].value("OutputSegments", 0));
+
+	// A trajectory is appended to its segment as a whole, so its length must be known before it is written.
+	if (config->getOutputSegmentCount() > 0 && config->getStreamOutput()) {
+		cerr << "ERROR: Consolidated output (OutputSegments) cannot be streamed." << endl;
+		exit(1);
+	}
+
+	if (config->getOutputSegmentCount() > 0 && config->getOutputFormat() == "summary") {
+		cerr << "ERROR: The summary output type writes no trajectories to consolidate (OutputSegments)." << endl;
+		exit(1);
+	}
+
+	// Parse the compression of the output files. By default they are not compressed.
+	string compression = configJson["general"].value("Compression", string("None"));
+	if (compression == "None") {
+		config->setOutputCompression(Configuration::OutputCompression::NO_COMPRESSION);
+	}
+	else if (compression == "Gzip") {
+		config->setOutputCompression(Configuration::OutputCompression::GZIP);
+	}
+	else if (compression == "Zstd") {
+		config->setOutputCompression(Configuration::OutputCompression::ZSTD);
+	}
+	else {
+		cerr << "ERROR: Unknown compression " << compression << "." << endl;
+		exit(1);
+	}
+
+	if (!OutputStream::isAvailable(config->getOutputCompression())) {
+		cerr << "ERROR: The " << compression << " compression is not available in this build." << endl;
+		exit(1);
+	}
+
+	// A level of 0 selects the default level of the library, the others must be in its range.
+	int compressionLevel = configJson["general"].value("CompressionLevel", 0);
+	int maximumLevel = OutputStream::getMaximumLevel(config->getOutputCompression());
+	if (compressionLevel < 0) {
+		cerr << "ERROR: The compression level cannot be negative." << endl;
+		exit(1);
+	}
+	if (config->getOutputCompression() != Configuration::OutputCompression::NO_COMPRESSION && compressionLevel > maximumLevel) {
+		cerr << "ERROR: The " << compression << " compression level must be between 1 and " << maximumLevel << " (or 0 for the default)." << endl;
+		exit(1);
+	}
+	config->setCompressionLevel(compressionLevel);
+
+	// Parse the metrics added to the aggregated output. By default there are none, except with the summary output
+	// type, which has the peak, its time, the attack rate and the total deaths.
+	vector<string> metricNames;
+	if (configJson["general"].contains("Metrics")) {
+		metricNames = configJson["general"]["Metrics"].get<vector<string>>();
+	}
+	else if (config->getOutputFormat() == "summary") {
+		metricNames = { "PeakInfected", "TimeOfPeak", "AttackRate", "TotalDeaths" };
+	}
+
+	for (string& metric : metricNames) {
+		if (metric == "PeakInfected") {
+			config->addMetric(Configuration::TrajectoryMetric::PEAK_INFECTED);
+		}
+		else if (metric == "TimeOfPeak") {
+			config->addMetric(Configuration::TrajectoryMetric::TIME_OF_PEAK);
+		}
+		else if (metric == "FinalSize") {
+			config->addMetric(Configuration::TrajectoryMetric::FINAL_SIZE);
+		}
+		else if (metric == "AttackRate") {
+			config->addMetric(Configuration::TrajectoryMetric::ATTACK_RATE);
+		}
+		else if (metric == "TimeAboveThreshold") {
+			config->addMetric(Configuration::TrajectoryMetric::TIME_ABOVE_THRESHOLD);
+		}
+		else if (metric == "TotalDeaths") {
+			config->addMetric(Configuration::TrajectoryMetric::TOTAL_DEATHS);
+		}
+		else if (metric == "DeathsByCause") {
+			config->addMetric(Configuration::TrajectoryMetric::DEATHS_BY_CAUSE);
+		}
+		else {
+			cerr << "ERROR: Unknown metric " << metric << "." << endl;
+			exit(1);
+		}
+	}
+
+	// The metrics are tracked on the compartments of the built-in types.
+	if (!config->getMetrics().empty() && config->getEngine() == Configuration::SimulationEngine::REACTION_NETWORK) {
+		cerr << "ERROR: Metrics are not available with the Network engine." << endl;
+		exit(1);
+	}
+
+	config->setMetricThreshold(configJson["general"].value("MetricThreshold", 0));
+
 	// Parse duration.
 	config->setMaximumDuration(configJson["general"]["SimulationDuration"]["maximum_duration(time_units)"]);
 	config->setNumberOfSimulations(configJson["general"]["NumberOfSimulations"]);
 
+	// Parse the integration step of the continuous engines.
+	config->setTimeStep(configJson["general"]["SimulationDuration"].value("time_step(time_units)", 0.01));
+	if (config->getTimeStep() <= 0) {
+		cerr << "ERROR: The time step must be positive." << endl;
+		exit(1);
+	}
+
+	// Parse the sampling grid. Without one, the state is recorded after every step.
+	parseSamplingGrid(configJson["general"]["SimulationDuration"]);
+
+	// Parse the ensemble output, whose statistics are computed on the sampling grid of the built-in types.
+	config->setEnsembleOutput(configJson["general"].value("EnsembleOutput", false));
+
+	if (config->getEnsembleOutput() && config->getSamplingTimes().empty()) {
+		cerr << "ERROR: The ensemble output (EnsembleOutput) requires a sampling grid in config file." << endl;
+		exit(1);
+	}
+	if (config->getEnsembleOutput() && config->getEngine() == Configuration::SimulationEngine::REACTION_NETWORK) {
+		cerr << "ERROR: The ensemble output (EnsembleOutput) is not available with the Network engine." << endl;
+		exit(1);
+	}
+
+	// Parse the quantile output. The bands of the infected count are only computed on a sampling grid.
+	config->setQuantileOutput(configJson["general"].value("QuantileOutput", false));
+
+	if (config->getQuantileOutput() && config->getEngine() == Configuration::SimulationEngine::REACTION_NETWORK) {
+		cerr << "ERROR: The quantile output (QuantileOutput) is not available with the Network engine." << endl;
+		exit(1);
+	}
+
 	// Parse number of threads.
 	config->setNumberOfThreads(configJson["general"]["NumberOfThreads"]);
+	config->setOutputThreadCount(configJson["general"].value("OutputThreads", 0));
+
+	// Parse the master seed. Without one, the seed is taken from the clock (non-reproducible runs).
+	if (configJson["general"].contains("Seed")) {
+		config->setSeed(configJson["general"]["Seed"]);
+	}
+	else {
+		config->setSeed(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+	}
+
+	// Custom models describe their compartments, parameters and reactions in the model object.
+	if (config->getType() == Configuration::SimulationType::CUSTOM) {
+		parseModel(configJson["model"]);
+		configFile.close();
+		return;
+	}
 
 	// Parse populations.
 
@@ -97,7 +314,129 @@ void ConfigFileParser::parse() {
 	config->addVaccinationTimestampBoundary(configJson["events"]["Vaccination"]["timestamp_upper_bound"]);
 
 	config->setVaccinationEfficiency(configJson["events"]["Vaccination"]["vaccination_efficiency"]);
+
+	// Vaccination campaigns repeat the vaccination every interval after the first one. A single vaccination by default.
+	int vaccinationCount = configJson["events"]["Vaccination"].value("repeat_count", 1);
+	double vaccinationInterval = configJson["events"]["Vaccination"].value("repeat_interval(time_units)", 0.0);
+	if (vaccinationCount < 1 || (vaccinationCount > 1 && vaccinationInterval <= 0)) {
+		cerr << "ERROR: Vaccination repeats need a positive count and interval." << endl;
+		exit(1);
+	}
+	config->setVaccinationRepeats(vaccinationCount, vaccinationInterval);
 	config->setRevaccinationEfficiency(configJson["events"]["Revaccination"]["revaccination_efficiency"]);
 
 	configFile.close();
-}
\ No newline at end of file
+}
+
+void ConfigFileParser::parseModel(json& modelJson) {
+
+	ReactionNetwork& network = config->getNetwork();
+
+	// Parse compartments.
+	for (auto& compartment : modelJson["compartments"]) {
+		network.addCompartment(compartment["name"], compartment["lower_bound"], compartment["upper_bound"], compartment.value("infectious", false));
+	}
+
+	// Parse parameters.
+	for (auto& parameter : modelJson["parameters"]) {
+		network.addParameter(parameter["name"], parameter["lower_bound"], parameter["upper_bound"]);
+	}
+
+	// Parse reactions.
+	for (auto& reaction : modelJson["reactions"]) {
+
+		ReactionNetwork::RateLaw rateLaw;
+		if (reaction["rate_law"] == "mass_action") {
+			rateLaw = ReactionNetwork::RateLaw::MASS_ACTION;
+		}
+		else if (reaction["rate_law"] == "frequency_dependent") {
+			rateLaw = ReactionNetwork::RateLaw::FREQUENCY_DEPENDENT;
+		}
+		else {
+			cerr << "ERROR: Invalid rate law of reaction " << reaction["name"] << " in config file." << endl;
+			exit(1);
+		}
+
+		int rateParameter = network.findParameter(reaction["rate"]);
+		if (rateParameter == -1) {
+			cerr << "ERROR: Unknown rate parameter of reaction " << reaction["name"] << " in config file." << endl;
+			exit(1);
+		}
+
+		vector<pair<int, int>> sides[2];
+		const char* sideNames[2] = { "reactants", "products" };
+		for (int side = 0; side < 2; side++) {
+			if (!reaction.contains(sideNames[side])) {
+				continue;
+			}
+			for (auto& term : reaction[sideNames[side]].items()) {
+				int compartment = network.findCompartment(term.key());
+				if (compartment == -1) {
+					cerr << "ERROR: Unknown compartment " << term.key() << " in reaction " << reaction["name"] << " in config file." << endl;
+					exit(1);
+				}
+				sides[side].push_back(make_pair(compartment, (int)term.value()));
+			}
+		}
+
+		network.addReaction(reaction["name"], rateLaw, rateParameter, sides[0], sides[1]);
+	}
+
+	bool infectiousFound = false;
+	for (int i = 0; i < network.getCompartmentCount(); i++) {
+		infectiousFound = infectiousFound || network.isInfectious(i);
+	}
+	if (!infectiousFound) {
+		cerr << "ERROR: At least one compartment of the model has to be infectious." << endl;
+		exit(1);
+	}
+
+	network.compile();
+}
+
+void ConfigFileParser::parseSamplingGrid(json& durationJson) {
+
+	bool hasInterval = durationJson.contains("sampling_interval(time_units)");
+	bool hasTimes = durationJson.contains("sampling_times(time_units)");
+
+	if (!hasInterval && !hasTimes) {
+		return;
+	}
+	if (hasInterval && hasTimes) {
+		cerr << "ERROR: Only one of sampling_interval and sampling_times can be given in config file." << endl;
+		exit(1);
+	}
+
+	vector<double> samplingTimes;
+
+	if (hasInterval) {
+		double interval = durationJson["sampling_interval(time_units)"];
+		if (interval <= 0) {
+			cerr << "ERROR: The sampling interval must be positive." << endl;
+			exit(1);
+		}
+
+		// The grid covers the maximum duration, or the two years after which every simulation is ended.
+		double end = config->getMaximumDuration() != 0 ? config->getMaximumDuration() : 730;
+		int count = (int)floor(end / interval + 1e-9) + 1;
+		for (int k = 0; k < count; k++) {
+			samplingTimes.push_back(k * interval);
+		}
+	}
+	else {
+		for (double time : durationJson["sampling_times(time_units)"]) {
+			if (time < 0) {
+				cerr << "ERROR: Sampling times cannot be negative." << endl;
+				exit(1);
+			}
+			samplingTimes.push_back(time);
+		}
+
+		// The initial state is always recorded.
+		samplingTimes.push_back(0);
+		sort(samplingTimes.begin(), samplingTimes.end());
+		samplingTimes.erase(unique(samplingTimes.begin(), samplingTimes.end()), samplingTimes.end());
+	}
+
+	config->setSamplingTimes(samplingTimes);
+}
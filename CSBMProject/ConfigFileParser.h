@@ -18,6 +18,10 @@ public:
 	void parse();
 
 private:
+
+	// Private helper functions.
+	void parseModel(json& modelJson);
+	void parseSamplingGrid(json& durationJson);
 	
 	string configFilename;
 	Configuration* config;
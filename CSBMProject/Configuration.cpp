@@ -4,4 +4,46 @@
 Configuration::Configuration(string configFilename) {
 	ConfigFileParser configFileParser(this, configFilename);
 	configFileParser.parse();
+}
+
+void Configuration::buildTypeNetwork() {
+
+	network = ReactionNetwork();
+
+	// The exposed and infected compartments are infectious, as in SimulationInfo::getInfectousCount.
+	const char* compartmentNames[] = { "Susceptible", "Exposed", "Infected", "Recovered" };
+	for (int i = 0; i < 4; i++) {
+		network.addCompartment(compartmentNames[i], populationBoundaries[i][0], populationBoundaries[i][1], i == 1 || i == 2);
+	}
+
+	const char* parameterNames[] = { "MortalityRate (m)", "InfectedMortalityRate (v)", "RecoveryRate (r)", "IncubationPeriod (I)", "InfectionRate (b)" };
+	for (int i = 0; i < 5; i++) {
+		network.addParameter(parameterNames[i], parameterBoundaries[i][0], parameterBoundaries[i][1]);
+	}
+
+	const int S = 0, E = 1, I = 2, R = 3;
+	const int m = 0, v = 1, r = 2, incubation = 3, b = 4;
+	const ReactionNetwork::RateLaw massAction = ReactionNetwork::RateLaw::MASS_ACTION;
+	const ReactionNetwork::RateLaw frequencyDependent = ReactionNetwork::RateLaw::FREQUENCY_DEPENDENT;
+
+	// Same elementary events as SimulationInfo, without the ones that cannot occur in the type.
+	if (type != Configuration::SimulationType::SEIR_simplified) {
+		network.addReaction("Birth", frequencyDependent, m, {}, { { S, 1 } });
+		network.addReaction("Death of susceptible", massAction, m, { { S, 1 } }, {});
+	}
+	if (type != Configuration::SimulationType::SIR) {
+		network.addReaction("Sickness", massAction, incubation, { { E, 1 } }, { { I, 1 } });
+	}
+	if (type != Configuration::SimulationType::SEIR_simplified) {
+		network.addReaction("Death of infected", massAction, m, { { I, 1 } }, {});
+		network.addReaction("Death of recovered", massAction, m, { { R, 1 } }, {});
+	}
+	network.addReaction("Infection", frequencyDependent, b, { { S, 1 }, { I, 1 } },
+		{ { type == Configuration::SimulationType::SIR ? I : E, 1 }, { I, 1 } });
+	if (type != Configuration::SimulationType::SEIR_simplified) {
+		network.addReaction("Death due to infection", massAction, v, { { I, 1 } }, {});
+	}
+	network.addReaction("Recovery", massAction, r, { { I, 1 } }, { { R, 1 } });
+
+	network.compile();
 }
\ No newline at end of file
@@ -3,6 +3,9 @@
 
 #include <iostream>
 #include <vector>
+#include <cstdint>
+
+#include "ReactionNetwork.h"
 
 using namespace std;
 
@@ -14,7 +17,39 @@ public:
 	enum SimulationType {
 		SIR,
 		SEIR,
-		SEIR_simplified
+		SEIR_simplified,
+		CUSTOM
+	};
+
+	// The supported stochastic simulation engines.
+	enum SimulationEngine {
+		DIRECT,
+		INCREMENTAL_DIRECT,
+		OPTIMIZED_DIRECT,
+		NEXT_REACTION,
+		TAU_LEAPING,
+		LANGEVIN,
+		MEAN_FIELD,
+		REACTION_NETWORK,
+		BATCH
+	};
+
+	// The supported compressions of the output files.
+	enum OutputCompression {
+		NO_COMPRESSION,
+		GZIP,
+		ZSTD
+	};
+
+	// The per-simulation metrics which can be added to the aggregated output.
+	enum TrajectoryMetric {
+		PEAK_INFECTED,
+		TIME_OF_PEAK,
+		FINAL_SIZE,
+		ATTACK_RATE,
+		TIME_ABOVE_THRESHOLD,
+		TOTAL_DEATHS,
+		DEATHS_BY_CAUSE
 	};
 
 	// Constructor.
@@ -23,12 +58,16 @@ public:
 
 	// Setter methods.
 	void setType(SimulationType simulationType) { type = simulationType; }
+	void setEngine(SimulationEngine simulationEngine) { engine = simulationEngine; }
 	void setMaximumDuration(double maxDuration) { maximumDuration = maxDuration; }
+	void setTimeStep(double step) { timeStep = step; }
+	void setSamplingTimes(vector<double> times) { samplingTimes = times; }
 
 	void setNumberOfSimulations(int simulationCount) {
 		numberOfSimulations = simulationCount;
 	}
 	void setNumberOfThreads(int numberOfThreads) { threadCount = numberOfThreads; }
+	void setSeed(uint64_t masterSeed) { seed = masterSeed; }
 
 	void addPopulationBoundary(vector<int> boundaries) {
 		populationBoundaries.push_back(boundaries);
@@ -41,6 +80,7 @@ public:
 	}
 
 	void setVaccinationEfficiency(double efficiency) { vaccinationEfficiency = efficiency; }
+	void setVaccinationRepeats(int count, double interval) { vaccinationCount = count; vaccinationInterval = interval; }
 
 	void setRevaccinationEfficiency(double efficiency) { revaccinationEfficiency = efficiency; }
 
@@ -48,42 +88,98 @@ public:
 		events.push_back(event);
 	}
 	void setOutputFormat(string format) { outputFormat = format; }
+	void setStreamOutput(bool stream) { streamOutput = stream; }
+	void setOutputThreadCount(int count) { outputThreadCount = count; }
+	void setOutputSegmentCount(int count) { outputSegmentCount = count; }
+	void setOutputCompression(OutputCompression compression) { outputCompression = compression; }
+	void setCompressionLevel(int level) { compressionLevel = level; }
+	void addMetric(TrajectoryMetric metric) { metrics.push_back(metric); }
+	void setMetricThreshold(int threshold) { metricThreshold = threshold; }
+	void setEnsembleOutput(bool ensemble) { ensembleOutput = ensemble; }
+	void setQuantileOutput(bool quantiles) { quantileOutput = quantiles; }
 
 	// Getter methods.
 	SimulationType getType() { return type; }
+	SimulationEngine getEngine() { return engine; }
 	string getOutputFormat() { return outputFormat; }
+	// Whether the records are written in chunks while the simulations run, instead of after each of them ends.
+	bool getStreamOutput() { return streamOutput; }
+	// Number of dedicated output threads; 0 when the simulation threads write their own output files.
+	int getOutputThreadCount() { return outputThreadCount; }
+	// Number of segment files all trajectories are appended to; 0 when every simulation writes a file of its own.
+	int getOutputSegmentCount() { return outputSegmentCount; }
+	OutputCompression getOutputCompression() { return outputCompression; }
+	// Level of the compression; 0 selects the default level of the compression library.
+	int getCompressionLevel() { return compressionLevel; }
+	// Metrics written to the aggregated output, in their order of the columns.
+	const vector<TrajectoryMetric>& getMetrics() { return metrics; }
+	// Infected count above which the time is counted by the TIME_ABOVE_THRESHOLD metric.
+	int getMetricThreshold() { return metricThreshold; }
+	// Whether the ensemble statistics on the sampling grid are written to ensemble.csv.
+	bool getEnsembleOutput() { return ensembleOutput; }
+	// Whether the quantiles of the summary metrics (and of the infected count on the sampling grid) are written.
+	bool getQuantileOutput() { return quantileOutput; }
 	double getMaximumDuration() { return maximumDuration; }
+	double getTimeStep() { return timeStep; }
+	// Time points of the fixed sampling grid, shared by all simulations. Empty when every step is recorded.
+	const vector<double>& getSamplingTimes() { return samplingTimes; }
 	int getNumberOfSimulations() { return numberOfSimulations; }
 
 	int GetThreadCount() { return threadCount; }
+	uint64_t getSeed() { return seed; }
 
 	vector<vector<int>> getPopulationBoundaries() { return populationBoundaries; }
 	vector<vector<double>> getParameterBoundaries() { return parameterBoundaries; }
 	vector<bool> getEvents() { return events; }
 
+	// The reaction network of a Custom model. buildTypeNetwork writes the built-in type as a reaction network
+	// instead (without the interventions), so the benchmarks can compare the reaction table with its kernels.
+	ReactionNetwork& getNetwork() { return network; }
+	void buildTypeNetwork();
+
 	vector<double> getVaccinationTimestampBoundaries() { return vaccinationTimestampBoundaries; }
 	double getVaccinationEfficiency() { return vaccinationEfficiency; }
+	int getVaccinationCount() { return vaccinationCount; }
+	double getVaccinationInterval() { return vaccinationInterval; }
 	double getRevaccinationEfficiency() { return revaccinationEfficiency; }
 
 private:
 
 	SimulationType type;
+	SimulationEngine engine;
 	string outputFormat;
+	bool streamOutput = false;
+	int outputThreadCount = 0;
+	int outputSegmentCount = 0;
+	OutputCompression outputCompression = NO_COMPRESSION;
+	int compressionLevel = 0;
+	vector<TrajectoryMetric> metrics;
+	int metricThreshold = 0;
+	bool ensembleOutput = false;
+	bool quantileOutput = false;
 
 	double maximumDuration;
+	double timeStep;
+	vector<double> samplingTimes;
 
 	int numberOfSimulations;
 
 	int threadCount;
 
+	uint64_t seed;
+
 	vector<vector<int>> populationBoundaries;
 	vector<vector<double>> parameterBoundaries;
 
 	vector<bool> events;
 	vector<double> vaccinationTimestampBoundaries;
 	double vaccinationEfficiency;
+	int vaccinationCount = 1;
+	double vaccinationInterval = 0;
 	double revaccinationEfficiency;
 
+	ReactionNetwork network;
+
 };
 
 #endif
\ No newline at end of file
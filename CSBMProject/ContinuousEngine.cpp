@@ -0,0 +1,34 @@
+#include "ContinuousEngine.h"
+
+#include <cmath>
+#include <algorithm>
+
+void ContinuousEngine::loadContinuousState(SimulationInfo& simulation) {
+	for (int j = 0; j < SimulationInfo::COMPARTMENT_COUNT; j++) {
+		continuousCompartments[j] = simulation.compartmentPopulation(j);
+	}
+	for (int i = 0; i < SimulationInfo::ELEMENTARY_EVENT_COUNT; i++) {
+		continuousFirings[i] = (double)simulation.firingCounts[i];
+	}
+}
+
+void ContinuousEngine::storeContinuousState(SimulationInfo& simulation) {
+
+	// Round the continuous state to the integer populations used for recording and stopping.
+	simulation.susceptible = (int)llround(continuousCompartments[SimulationInfo::SUSCEPTIBLE]);
+	simulation.exposed = (int)llround(continuousCompartments[SimulationInfo::EXPOSED]);
+	simulation.infected = (int)llround(continuousCompartments[SimulationInfo::INFECTED]);
+	simulation.recovered = (int)llround(continuousCompartments[SimulationInfo::RECOVERED]);
+	simulation.totalPopulation = simulation.susceptible + simulation.exposed + simulation.infected + simulation.recovered;
+
+	for (int i = 0; i < SimulationInfo::ELEMENTARY_EVENT_COUNT; i++) {
+		simulation.firingCounts[i] = max(llround(continuousFirings[i]), 0LL);
+	}
+
+	simulation.births = (int)simulation.firingCounts[SimulationInfo::BIRTH];
+	simulation.diedS = (int)simulation.firingCounts[SimulationInfo::DEATH_OF_SUSCEPTIBLE];
+	simulation.diedI = (int)simulation.firingCounts[SimulationInfo::DEATH_OF_INFECTED];
+	simulation.diedR = (int)simulation.firingCounts[SimulationInfo::DEATH_OF_RECOVERED];
+	simulation.diedDueToI = (int)simulation.firingCounts[SimulationInfo::DEATH_DUE_TO_INFECTION];
+	simulation.deathsTotal = simulation.diedS + simulation.diedI + simulation.diedR + simulation.diedDueToI;
+}
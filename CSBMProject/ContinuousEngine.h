@@ -0,0 +1,24 @@
+#ifndef _CONTINUOUSENGINE_H_
+
+#define _CONTINUOUSENGINE_H_
+
+#include "StepEngine.h"
+#include "SimulationInfo.h"
+
+// Base of the engines integrating a continuous state: the compartments and the cumulative firings of every
+// elementary event, rounded to the integer state of the simulation after every step.
+class ContinuousEngine : public StepEngine {
+
+protected:
+
+	// Takes over the integer state of the simulation, at the start and after interventions changed it.
+	void loadContinuousState(SimulationInfo& simulation);
+
+	// Rounds the continuous state to the integer populations and counters used for recording and stopping.
+	void storeContinuousState(SimulationInfo& simulation);
+
+	double continuousCompartments[SimulationInfo::COMPARTMENT_COUNT];
+	double continuousFirings[SimulationInfo::ELEMENTARY_EVENT_COUNT];
+};
+
+#endif
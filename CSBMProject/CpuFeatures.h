@@ -0,0 +1,40 @@
+#ifndef _CPUFEATURES_H_
+
+#define _CPUFEATURES_H_
+
+// Runtime detection of the instruction sets used by the vectorized kernels.
+// Files defining AVX2 kernels mark them with AVX2_TARGET and only call them when cpuSupportsAvx2() is true.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CPU_FEATURES_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define AVX2_TARGET
+#else
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+inline bool cpuSupportsAvx2() {
+#ifdef CPU_FEATURES_X86
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) {
+		return false;
+	}
+	__cpuidex(info, 7, 0);
+	bool avx2 = (info[1] & (1 << 5)) != 0;
+	__cpuid(info, 1);
+	bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+	return avx2 && osSavesYmm;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+#else
+	return false;
+#endif
+}
+
+#endif
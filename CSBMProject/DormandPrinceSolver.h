@@ -0,0 +1,102 @@
+#ifndef _DORMANDPRINCESOLVER_H_
+
+#define _DORMANDPRINCESOLVER_H_
+
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+// Adaptive Runge-Kutta integrator using the Dormand-Prince 5(4) embedded pair.
+// The derivatives are given as a callable object f(const double state[], double derivatives[]).
+template <int DIMENSION>
+class DormandPrinceSolver {
+
+public:
+
+	// Constructor.
+	DormandPrinceSolver(double relative = 1e-6, double absolute = 1e-6) : relativeTolerance(relative), absoluteTolerance(absolute) {}
+
+	// Advances the state by one accepted step, starting with the given step size.
+	// Returns the size of the accepted step and stores the proposed size of the next one in step.
+	template <typename Derivatives>
+	double advance(double state[DIMENSION], double& step, Derivatives f) {
+
+		double k[7][DIMENSION];
+		double stage[DIMENSION];
+		double fifthOrder[DIMENSION];
+
+		f(state, k[0]);
+
+		while (true) {
+			double h = step;
+
+			for (int s = 1; s < 7; s++) {
+				for (int i = 0; i < DIMENSION; i++) {
+					double sum = 0;
+					for (int j = 0; j < s; j++) {
+						sum += A[s][j] * k[j][i];
+					}
+					stage[i] = state[i] + h * sum;
+				}
+				f(stage, k[s]);
+			}
+
+			// The last stage is evaluated at the fifth order solution, which is therefore equal to stage.
+			double error = 0;
+			for (int i = 0; i < DIMENSION; i++) {
+				fifthOrder[i] = stage[i];
+
+				double difference = 0;
+				for (int j = 0; j < 7; j++) {
+					difference += (B5[j] - B4[j]) * k[j][i];
+				}
+				difference *= h;
+
+				double scale = absoluteTolerance + relativeTolerance * max(fabs(state[i]), fabs(fifthOrder[i]));
+				error = max(error, fabs(difference) / scale);
+			}
+
+			// Standard step size controller with safety factor and growth limits.
+			double factor = error == 0 ? MAXIMUM_GROWTH : min(MAXIMUM_GROWTH, max(MINIMUM_GROWTH, SAFETY * pow(error, -0.2)));
+			step = h * factor;
+
+			if (error <= 1) {
+				for (int i = 0; i < DIMENSION; i++) {
+					state[i] = fifthOrder[i];
+				}
+				return h;
+			}
+		}
+	}
+
+private:
+
+	static constexpr double SAFETY = 0.9;
+	static constexpr double MINIMUM_GROWTH = 0.2;
+	static constexpr double MAXIMUM_GROWTH = 5.0;
+
+	static constexpr double A[7][6] = {
+		{ 0, 0, 0, 0, 0, 0 },
+		{ 1.0 / 5, 0, 0, 0, 0, 0 },
+		{ 3.0 / 40, 9.0 / 40, 0, 0, 0, 0 },
+		{ 44.0 / 45, -56.0 / 15, 32.0 / 9, 0, 0, 0 },
+		{ 19372.0 / 6561, -25360.0 / 2187, 64448.0 / 6561, -212.0 / 729, 0, 0 },
+		{ 9017.0 / 3168, -355.0 / 33, 46732.0 / 5247, 49.0 / 176, -5103.0 / 18656, 0 },
+		{ 35.0 / 384, 0, 500.0 / 1113, 125.0 / 192, -2187.0 / 6784, 11.0 / 84 }
+	};
+	static constexpr double B5[7] = { 35.0 / 384, 0, 500.0 / 1113, 125.0 / 192, -2187.0 / 6784, 11.0 / 84, 0 };
+	static constexpr double B4[7] = { 5179.0 / 57600, 0, 7571.0 / 16695, 393.0 / 640, -92097.0 / 339200, 187.0 / 2100, 1.0 / 40 };
+
+	double relativeTolerance;
+	double absoluteTolerance;
+};
+
+template <int DIMENSION> constexpr double DormandPrinceSolver<DIMENSION>::SAFETY;
+template <int DIMENSION> constexpr double DormandPrinceSolver<DIMENSION>::MINIMUM_GROWTH;
+template <int DIMENSION> constexpr double DormandPrinceSolver<DIMENSION>::MAXIMUM_GROWTH;
+template <int DIMENSION> constexpr double DormandPrinceSolver<DIMENSION>::A[7][6];
+template <int DIMENSION> constexpr double DormandPrinceSolver<DIMENSION>::B5[7];
+template <int DIMENSION> constexpr double DormandPrinceSolver<DIMENSION>::B4[7];
+
+#endif
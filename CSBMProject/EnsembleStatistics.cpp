@@ -0,0 +1,90 @@
+#include "EnsembleStatistics.h"
+
+#include <cmath>
+
+EnsembleStatistics::EnsembleStatistics(const vector<double>& gridTimes, bool withQuantiles) : gridTimes(&gridTimes) {
+	accumulators.resize(gridTimes.size() * COMPARTMENT_COUNT);
+	if (withQuantiles) {
+		infectedSketches.assign(gridTimes.size(), QuantileSketch(true));
+	}
+}
+
+void EnsembleStatistics::merge(const EnsembleStatistics& other) {
+
+	// The parallel variant of Welford's method (Chan et al.).
+	for (size_t i = 0; i < accumulators.size(); i++) {
+		Accumulator& accumulator = accumulators[i];
+		const Accumulator& added = other.accumulators[i];
+
+		if (added.count == 0) {
+			continue;
+		}
+
+		long long count = accumulator.count + added.count;
+		double delta = added.mean - accumulator.mean;
+		accumulator.mean += delta * added.count / count;
+		accumulator.squaredDeviations += added.squaredDeviations + delta * delta * accumulator.count * added.count / count;
+		accumulator.count = count;
+	}
+
+	for (size_t i = 0; i < infectedSketches.size(); i++) {
+		infectedSketches[i].merge(other.infectedSketches[i]);
+	}
+}
+
+void EnsembleStatistics::outputCSV(ostream& cout, bool withExposed) {
+
+	static const char* COMPARTMENT_NAMES[COMPARTMENT_COUNT] = { "Susceptible", "Exposed", "Infected", "Recovered" };
+
+	cout << "Time,Simulations";
+	for (int i = 0; i < COMPARTMENT_COUNT; i++) {
+		if (i == 1 && !withExposed) {
+			continue;
+		}
+		cout << "," << COMPARTMENT_NAMES[i] << " Mean";
+		cout << "," << COMPARTMENT_NAMES[i] << " Variance";
+		cout << "," << COMPARTMENT_NAMES[i] << " CI Lower";
+		cout << "," << COMPARTMENT_NAMES[i] << " CI Upper";
+	}
+	cout << endl;
+
+	for (size_t gridPoint = 0; gridPoint < gridTimes->size(); gridPoint++) {
+		const Accumulator* gridAccumulators = &accumulators[gridPoint * COMPARTMENT_COUNT];
+
+		cout << (*gridTimes)[gridPoint] << "," << gridAccumulators[0].count;
+		for (int i = 0; i < COMPARTMENT_COUNT; i++) {
+			if (i == 1 && !withExposed) {
+				continue;
+			}
+
+			const Accumulator& accumulator = gridAccumulators[i];
+			double variance = accumulator.count > 1 ? accumulator.squaredDeviations / (accumulator.count - 1) : 0;
+			double halfWidth = accumulator.count > 0 ? CONFIDENCE_QUANTILE * sqrt(variance / accumulator.count) : 0;
+
+			cout << "," << accumulator.mean;
+			cout << "," << variance;
+			cout << "," << accumulator.mean - halfWidth;
+			cout << "," << accumulator.mean + halfWidth;
+		}
+		cout << endl;
+	}
+}
+
+void EnsembleStatistics::outputQuantilesCSV(ostream& cout) {
+
+	cout << "Time,Simulations";
+	for (int i = 0; i < QuantileSketch::REPORTED_QUANTILE_COUNT; i++) {
+		cout << ",Infected " << QuantileSketch::REPORTED_QUANTILE_NAMES[i];
+	}
+	cout << endl;
+
+	for (size_t gridPoint = 0; gridPoint < infectedSketches.size(); gridPoint++) {
+		const QuantileSketch& sketch = infectedSketches[gridPoint];
+
+		cout << (*gridTimes)[gridPoint] << "," << sketch.getCount();
+		for (int i = 0; i < QuantileSketch::REPORTED_QUANTILE_COUNT; i++) {
+			cout << "," << sketch.getQuantile(QuantileSketch::REPORTED_QUANTILES[i]);
+		}
+		cout << endl;
+	}
+}
@@ -0,0 +1,76 @@
+#ifndef _ENSEMBLESTATISTICS_H_
+
+#define _ENSEMBLESTATISTICS_H_
+
+#include <vector>
+#include <ostream>
+
+#include "QuantileSketch.h"
+
+using namespace std;
+
+// Mean and variance of the compartments at every point of the sampling grid, over all simulations. Every thread
+// adds the states of the simulations it runs to statistics of its own with Welford's method, and the statistics
+// of the threads are merged once all simulations have ended, so no trajectory has to be kept or read again. The
+// memory depends on the size of the grid only. With quantiles, the distribution of the infected count at every grid
+// point is also kept in a quantile sketch.
+class EnsembleStatistics {
+
+public:
+
+	// Susceptible, exposed, infected and recovered.
+	static const int COMPARTMENT_COUNT = 4;
+
+	// Constructor.
+	EnsembleStatistics(const vector<double>& gridTimes, bool withQuantiles);
+
+	const size_t getGridSize() { return gridTimes->size(); }
+	const double getGridTime(size_t gridPoint) { return (*gridTimes)[gridPoint]; }
+
+	// Adds the compartments of a simulation at a grid point.
+	void add(size_t gridPoint, const int* compartments) {
+		Accumulator* gridAccumulators = &accumulators[gridPoint * COMPARTMENT_COUNT];
+		for (int i = 0; i < COMPARTMENT_COUNT; i++) {
+			gridAccumulators[i].add(compartments[i]);
+		}
+		if (!infectedSketches.empty()) {
+			infectedSketches[gridPoint].add(compartments[INFECTED]);
+		}
+	}
+
+	// Adds the states added to other, as if they had been added to these statistics.
+	void merge(const EnsembleStatistics& other);
+
+	// Writes the mean, variance and 95% confidence interval of the mean of every compartment at every grid point.
+	void outputCSV(ostream& cout, bool withExposed);
+
+	// Writes the quantiles of the infected count at every grid point.
+	void outputQuantilesCSV(ostream& cout);
+
+private:
+
+	static const int INFECTED = 2;
+
+	// Running count, mean and sum of squared deviations from the mean.
+	struct Accumulator {
+		long long count = 0;
+		double mean = 0;
+		double squaredDeviations = 0;
+
+		void add(double value) {
+			count++;
+			double delta = value - mean;
+			mean += delta / count;
+			squaredDeviations += delta * (value - mean);
+		}
+	};
+
+	// Quantile of the standard normal distribution bounding the 95% confidence interval.
+	static constexpr double CONFIDENCE_QUANTILE = 1.959964;
+
+	const vector<double>* gridTimes;
+	vector<Accumulator> accumulators;
+	vector<QuantileSketch> infectedSketches;
+};
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef _INDEXEDPRIORITYQUEUE_H_
+
+#define _INDEXEDPRIORITYQUEUE_H_
+
+#include <vector>
+
+using namespace std;
+
+// A binary min-heap over a fixed set of indices [0, size), each with a key that can be changed in O(log size).
+// Used by the next reaction method to find the elementary event with the earliest putative firing time.
+class IndexedPriorityQueue {
+
+public:
+
+	// Constructor.
+	IndexedPriorityQueue(int size = 0) : keys(size, 0), heap(size), positions(size) {
+		for (int i = 0; i < size; i++) {
+			heap[i] = i;
+			positions[i] = i;
+		}
+	}
+
+	// Getter methods.
+	int top() { return heap[0]; }
+	double topKey() { return keys[heap[0]]; }
+	double getKey(int index) { return keys[index]; }
+
+	// Changes the key of the given index and restores the heap order.
+	void update(int index, double key) {
+		double oldKey = keys[index];
+		keys[index] = key;
+
+		if (key < oldKey) {
+			siftUp(positions[index]);
+		}
+		else {
+			siftDown(positions[index]);
+		}
+	}
+
+private:
+
+	void siftUp(int position) {
+		while (position > 0) {
+			int parent = (position - 1) / 2;
+			if (keys[heap[parent]] <= keys[heap[position]]) {
+				break;
+			}
+			swapNodes(position, parent);
+			position = parent;
+		}
+	}
+
+	void siftDown(int position) {
+		int size = (int)heap.size();
+		while (true) {
+			int smallest = position;
+			int left = 2 * position + 1;
+			int right = left + 1;
+
+			if (left < size && keys[heap[left]] < keys[heap[smallest]]) {
+				smallest = left;
+			}
+			if (right < size && keys[heap[right]] < keys[heap[smallest]]) {
+				smallest = right;
+			}
+			if (smallest == position) {
+				break;
+			}
+			swapNodes(position, smallest);
+			position = smallest;
+		}
+	}
+
+	void swapNodes(int first, int second) {
+		int index = heap[first];
+		heap[first] = heap[second];
+		heap[second] = index;
+
+		positions[heap[first]] = first;
+		positions[heap[second]] = second;
+	}
+
+	vector<double> keys;
+	vector<int> heap;
+	vector<int> positions;
+};
+
+#endif
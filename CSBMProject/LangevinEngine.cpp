@@ -0,0 +1,51 @@
+#include "LangevinEngine.h"
+
+#include <cmath>
+#include <algorithm>
+
+double LangevinEngine::step(SimulationInfo& simulation, double currentTime) {
+
+	// Interventions change the integer populations, which are then taken over as the continuous state.
+	if (simulation.chancesStale) {
+		loadContinuousState(simulation);
+		simulation.chancesStale = false;
+	}
+
+	// Steps are shortened to end at the next intervention.
+	double interventionStep = simulation.nextInterventionTime - currentTime;
+	double step = min(timeStep, interventionStep);
+
+	// Euler-Maruyama step of the chemical Langevin equation: every elementary event fires its expected
+	// number of times plus Gaussian noise with the same variance.
+	double noiseScale = sqrt(step);
+	for (int i = 0; i < SimulationInfo::ELEMENTARY_EVENT_COUNT; i++) {
+		simulation.elementaryEventChances[i] = simulation.elementaryEventChance(i, continuousCompartments);
+	}
+
+	for (int i = 0; i < SimulationInfo::ELEMENTARY_EVENT_COUNT; i++) {
+		double chance = simulation.elementaryEventChances[i];
+		if (chance <= 0) {
+			continue;
+		}
+
+		double firings = chance * step + sqrt(chance) * noiseScale * simulation.rng.nextNormal();
+		continuousFirings[i] += firings;
+		for (int j = 0; j < SimulationInfo::TOTAL; j++) {
+			continuousCompartments[j] += simulation.stoichiometry[i][j] * firings;
+		}
+	}
+
+	// Compartments cannot become negative.
+	continuousCompartments[SimulationInfo::TOTAL] = 0;
+	for (int j = 0; j < SimulationInfo::TOTAL; j++) {
+		continuousCompartments[j] = max(continuousCompartments[j], 0.0);
+		continuousCompartments[SimulationInfo::TOTAL] += continuousCompartments[j];
+	}
+
+	storeContinuousState(simulation);
+
+	if (step == interventionStep) {
+		return simulation.applyScheduledInterventions();
+	}
+	return currentTime + step;
+}
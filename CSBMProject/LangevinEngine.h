@@ -0,0 +1,22 @@
+#ifndef _LANGEVINENGINE_H_
+
+#define _LANGEVINENGINE_H_
+
+#include "ContinuousEngine.h"
+
+// Chemical Langevin equation, integrated with fixed Euler-Maruyama steps.
+class LangevinEngine : public ContinuousEngine {
+
+public:
+
+	// Constructor.
+	LangevinEngine(double step) : timeStep(step) {}
+
+	double step(SimulationInfo& simulation, double currentTime) override;
+
+private:
+
+	double timeStep;
+};
+
+#endif
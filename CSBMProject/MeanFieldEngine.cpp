@@ -0,0 +1,66 @@
+#include "MeanFieldEngine.h"
+
+#include <cmath>
+#include <algorithm>
+
+double MeanFieldEngine::step(SimulationInfo& simulation, double currentTime) {
+
+	if (simulation.chancesStale) {
+		loadContinuousState(simulation);
+		simulation.chancesStale = false;
+	}
+
+	double state[DIMENSION];
+	for (int j = 0; j < SimulationInfo::TOTAL; j++) {
+		state[j] = continuousCompartments[j];
+	}
+	for (int i = 0; i < SimulationInfo::ELEMENTARY_EVENT_COUNT; i++) {
+		state[SimulationInfo::TOTAL + i] = continuousFirings[i];
+	}
+
+	// Steps are shortened to end at the next intervention.
+	double interventionStep = simulation.nextInterventionTime - currentTime;
+	if (stepSize > interventionStep) {
+		stepSize = interventionStep;
+	}
+
+	double acceptedStep = solver.advance(state, stepSize, [&simulation](const double y[], double dy[]) {
+		derivatives(simulation, y, dy);
+	});
+
+	continuousCompartments[SimulationInfo::TOTAL] = 0;
+	for (int j = 0; j < SimulationInfo::TOTAL; j++) {
+		continuousCompartments[j] = max(state[j], 0.0);
+		continuousCompartments[SimulationInfo::TOTAL] += continuousCompartments[j];
+	}
+	for (int i = 0; i < SimulationInfo::ELEMENTARY_EVENT_COUNT; i++) {
+		continuousFirings[i] = state[SimulationInfo::TOTAL + i];
+	}
+
+	storeContinuousState(simulation);
+
+	if (acceptedStep == interventionStep) {
+		return simulation.applyScheduledInterventions();
+	}
+	return currentTime + acceptedStep;
+}
+
+void MeanFieldEngine::derivatives(SimulationInfo& simulation, const double state[], double derivatives[]) {
+
+	double compartments[SimulationInfo::COMPARTMENT_COUNT];
+	compartments[SimulationInfo::TOTAL] = 0;
+	for (int j = 0; j < SimulationInfo::TOTAL; j++) {
+		compartments[j] = max(state[j], 0.0);
+		compartments[SimulationInfo::TOTAL] += compartments[j];
+		derivatives[j] = 0;
+	}
+
+	// Every elementary event fires at the rate of its chance (law of mass action).
+	for (int i = 0; i < SimulationInfo::ELEMENTARY_EVENT_COUNT; i++) {
+		double chance = compartments[SimulationInfo::TOTAL] > 0 ? simulation.elementaryEventChance(i, compartments) : 0;
+		derivatives[SimulationInfo::TOTAL + i] = chance;
+		for (int j = 0; j < SimulationInfo::TOTAL; j++) {
+			derivatives[j] += simulation.stoichiometry[i][j] * chance;
+		}
+	}
+}
@@ -0,0 +1,29 @@
+#ifndef _MEANFIELDENGINE_H_
+
+#define _MEANFIELDENGINE_H_
+
+#include "ContinuousEngine.h"
+#include "DormandPrinceSolver.h"
+
+// Deterministic mean-field equations, integrated with the adaptive Dormand-Prince solver.
+class MeanFieldEngine : public ContinuousEngine {
+
+public:
+
+	// Constructor. The step size adapts from the given initial one.
+	MeanFieldEngine(double initialStepSize) : stepSize(initialStepSize) {}
+
+	double step(SimulationInfo& simulation, double currentTime) override;
+
+private:
+
+	// The state of the solver: the continuous compartments (without the total) followed by the cumulative firings.
+	static const int DIMENSION = 4 + SimulationInfo::ELEMENTARY_EVENT_COUNT;
+
+	static void derivatives(SimulationInfo& simulation, const double state[], double derivatives[]);
+
+	DormandPrinceSolver<DIMENSION> solver;
+	double stepSize;
+};
+
+#endif
@@ -0,0 +1,266 @@
+#include "NetworkSimulation.h"
+
+#include <random>
+#include <omp.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <limits>
+
+NetworkSimulation::NetworkSimulation(Configuration& config, const ReactionNetwork* reactionNetwork) :
+	NetworkSimulation(config, reactionNetwork, TrajectoryStream::generateID()) {}
+
+NetworkSimulation::NetworkSimulation(Configuration& config, const ReactionNetwork* reactionNetwork, int simulationID) :
+	id(simulationID), network(reactionNetwork), trajectoryStream(config, simulationID) {
+
+	// The random stream depends on the master seed and the simulation ID only, like the one of a SimulationInfo.
+	rng = RandomGenerator(config.getSeed(), id);
+
+	if (!config.getSamplingTimes().empty()) {
+		samplingTimes = &config.getSamplingTimes();
+	}
+
+	const ReactionNetwork& model = *network;
+
+	// Initialise the populations.
+	totalPopulation = 0;
+	for (int i = 0; i < model.getCompartmentCount(); i++) {
+		std::uniform_int_distribution<int> unif(model.getCompartmentBoundaries(i)[0], model.getCompartmentBoundaries(i)[1]);
+		populations.push_back(unif(rng));
+		totalPopulation += populations.back();
+	}
+
+	// Initialise the parameters.
+	for (int i = 0; i < model.getParameterCount(); i++) {
+		std::uniform_real_distribution<double> unif(model.getParameterBoundaries(i)[0], model.getParameterBoundaries(i)[1]);
+		parameters.push_back(unif(rng));
+	}
+
+	reactionChances.assign(model.getReactionCount(), 0);
+	firingCounts.assign(model.getReactionCount(), 0);
+}
+
+const int NetworkSimulation::getInfectousCount() {
+	const ReactionNetwork& model = *network;
+
+	int count = 0;
+	for (unsigned i = 0; i < populations.size(); i++) {
+		if (model.isInfectious(i)) {
+			count += populations[i];
+		}
+	}
+	return count;
+}
+
+void NetworkSimulation::updateAllChances() {
+	chancesTotal = 0;
+	for (unsigned i = 0; i < reactionChances.size(); i++) {
+		reactionChances[i] = network->reactionChance(i, populations.data(), totalPopulation, parameters.data());
+		chancesTotal += reactionChances[i];
+	}
+
+	chancesStale = false;
+	stepsSinceResummation = 0;
+}
+
+double NetworkSimulation::performStep(double currentTime) {
+
+	if (chancesStale) {
+		updateAllChances();
+	}
+
+	if (chancesTotal <= 0) {
+		return numeric_limits<double>::infinity();
+	}
+
+	double nextTime = currentTime + rng.nextExponential(chancesTotal);
+	double target = rng.nextUniform() * chancesTotal;
+
+	// Select the reaction on the line of all chances.
+	int selectedReaction = -1;
+	double linePointer = 0;
+	for (unsigned i = 0; i < reactionChances.size(); i++) {
+		if (reactionChances[i] != 0) {
+			linePointer += reactionChances[i];
+			selectedReaction = i;
+
+			if (target < linePointer) {
+				break;
+			}
+		}
+	}
+
+	// Every chance is zero and only the rounding of the running total kept it positive: no reaction can occur.
+	if (selectedReaction == -1) {
+		updateAllChances();
+		return numeric_limits<double>::infinity();
+	}
+
+	searchDepth += selectedReaction + 1;
+	firingCounts[selectedReaction]++;
+	network->applyReaction(selectedReaction, populations.data(), totalPopulation);
+
+	// Only recompute the chances of the reactions depending on the selected one.
+	for (const int* dependent = network->dependentsBegin(selectedReaction); dependent != network->dependentsEnd(selectedReaction); dependent++) {
+		double chance = network->reactionChance(*dependent, populations.data(), totalPopulation, parameters.data());
+		chancesTotal += chance - reactionChances[*dependent];
+		reactionChances[*dependent] = chance;
+	}
+
+	if (++stepsSinceResummation == RESUMMATION_INTERVAL) {
+		updateAllChances();
+	}
+
+	return nextTime;
+}
+
+void NetworkSimulation::saveIteration(double currentTime) {
+	endTime = currentTime;
+
+	if (samplingTimes == nullptr) {
+		recordPopulations(currentTime, populations);
+		return;
+	}
+
+	// The populations are piecewise constant: the previous ones held at every grid point passed since the last step.
+	while (nextSample < samplingTimes->size() && (*samplingTimes)[nextSample] < currentTime) {
+		recordPopulations((*samplingTimes)[nextSample++], heldPopulations);
+	}
+	heldPopulations = populations;
+}
+
+void NetworkSimulation::finishRecording() {
+
+	// The final populations are carried to the rest of the grid, so every simulation is recorded on the same time points.
+	if (samplingTimes == nullptr) {
+		return;
+	}
+	while (nextSample < samplingTimes->size()) {
+		recordPopulations((*samplingTimes)[nextSample++], heldPopulations);
+	}
+}
+
+const void NetworkSimulation::outputToFile(string format, SegmentedOutput* segments) {
+
+	if (format != "txt" && format != "csv") {
+		return;
+	}
+
+	// A streamed simulation already wrote its header and all but the last chunk of its records.
+	if (trajectoryStream.isStreaming()) {
+		flushRecords();
+		trajectoryStream.finish();
+
+		// Release the chunk, so a finished simulation only keeps its summary.
+		releaseRecords();
+		return;
+	}
+
+	long long eventCount = 0;
+	for (long long count : firingCounts) {
+		eventCount += count;
+	}
+
+	// The metrics are only tracked on the compartments of the built-in types, so they are left empty.
+	trajectoryStream.write(format, segments, endTime, eventCount, TrajectoryMetrics(), [this, &format](ostream& stream) {
+		outputHeader(stream, format, recordedPopulations.data());
+		outputRecords(stream, format);
+	});
+}
+
+void NetworkSimulation::startStreaming(OutputStream& stream, string format) {
+
+	if (format != "txt" && format != "csv") {
+		return;
+	}
+
+	trajectoryStream.start(stream, format);
+
+	// The iterations are saved from here on, so the initial populations are the current ones.
+	outputHeader(stream, format, populations.data());
+
+	timestamps.reserve(TrajectoryStream::CHUNK_SIZE);
+	recordedPopulations.reserve(TrajectoryStream::CHUNK_SIZE * populations.size());
+}
+
+void NetworkSimulation::flushRecords() {
+
+	outputRecords(trajectoryStream.getStream(), trajectoryStream.getFormat());
+
+	// Clearing keeps the capacity, so the chunk is reused for the next records.
+	timestamps.clear();
+	recordedPopulations.clear();
+}
+
+const void NetworkSimulation::outputHeader(ostream& cout, string format, const int initialPopulations[]) {
+
+	const ReactionNetwork& model = *network;
+	int compartmentCount = model.getCompartmentCount();
+
+	if (format == "csv") {
+		cout << "Time";
+		for (int i = 0; i < compartmentCount; i++) {
+			cout << "," << model.getCompartmentName(i);
+		}
+		cout << endl;
+		return;
+	}
+
+	cout << "Simulation ID-" << id << endl << "===================" << endl << endl;
+
+	cout << "1) General info " << endl << "-------------------" << endl;
+	cout << "Simulation type: Custom" << endl;
+	cout << "Thread ID: " << threadID << endl << endl;
+
+	cout << "2) Initial populations " << endl << "-------------------" << endl;
+	for (int i = 0; i < compartmentCount; i++) {
+		cout << model.getCompartmentName(i) << ": " << initialPopulations[i] << endl;
+	}
+	cout << endl;
+
+	cout << "3) Initial parameters " << endl << "-------------------" << endl;
+	for (int i = 0; i < model.getParameterCount(); i++) {
+		cout << model.getParameterName(i) << ": " << parameters[i] << endl;
+	}
+	cout << endl;
+
+	cout << "4) Simulation report " << endl << "-------------------" << endl << endl;
+
+	cout << "| Time  |";
+	for (int i = 0; i < compartmentCount; i++) {
+		cout << " " << setw(11) << left << model.getCompartmentName(i) << "|";
+	}
+	cout << endl;
+
+	cout.fill(' ');
+}
+
+const void NetworkSimulation::outputRecords(ostream& cout, string format) {
+
+	int compartmentCount = network->getCompartmentCount();
+	RecordFormatter formatter(cout);
+
+	if (format == "txt") {
+		for (unsigned row = 0; row < timestamps.size(); row++) {
+			formatter.append('|');
+			formatter.appendFixedPadded(timestamps[row], 3, 7);
+			formatter.append('|');
+			for (int i = 0; i < compartmentCount; i++) {
+				formatter.appendPadded(recordedPopulations[row * compartmentCount + i], 12);
+				formatter.append('|');
+			}
+			formatter.append('\n');
+		}
+		return;
+	}
+
+	for (unsigned row = 0; row < timestamps.size(); row++) {
+		formatter.append(timestamps[row]);
+		for (int i = 0; i < compartmentCount; i++) {
+			formatter.append(',');
+			formatter.append(recordedPopulations[row * compartmentCount + i]);
+		}
+		formatter.append('\n');
+	}
+}
@@ -0,0 +1,119 @@
+#ifndef _NETWORKSIMULATION_H_
+
+#define _NETWORKSIMULATION_H_
+
+#include <vector>
+#include <string>
+#include <fstream>
+
+#include "Configuration.h"
+#include "ReactionNetwork.h"
+#include "RandomGenerator.h"
+#include "SegmentedOutput.h"
+#include "OutputStream.h"
+#include "TrajectoryStream.h"
+#include "RecordFormatter.h"
+
+using namespace std;
+
+// A single simulation of a reaction network, run with the direct method on the network's flat reaction
+// table. Only the chances of the reactions depending on the last one are recomputed each step.
+class NetworkSimulation {
+
+public:
+
+	// Fields of a finished simulation needed by the aggregated output.
+	struct Summary {
+		double endTime;
+		vector<double> parameters;
+	};
+
+	// Constructors. Without an ID, the next one is generated.
+	NetworkSimulation(Configuration& config, const ReactionNetwork* reactionNetwork);
+	NetworkSimulation(Configuration& config, const ReactionNetwork* reactionNetwork, int simulationID);
+
+	// Getter methods.
+	const int getInfectousCount();
+	const double getParameter(int parameter) { return parameters[parameter]; }
+	const long long getFiringCount(int reaction) { return firingCounts[reaction]; }
+	const long long getSearchDepth() { return searchDepth; }
+	const double getEndTime() { return endTime; }
+	const Summary getSummary() { return Summary{ endTime, parameters }; }
+
+	// Simulation methods.
+	double performStep(double currentTime);
+	void saveIteration(double currentTime);
+	void finishRecording();
+
+	// Output methods, through the trajectory stream as for SimulationInfo.
+	void startStreaming(OutputStream& stream, string outputFormat);
+	const void outputToFile(string outputFormat, SegmentedOutput* segments = nullptr);
+
+	// The thread running the simulation, reported in the TXT output (which may be written by another thread).
+	void setThreadID(int thread) { threadID = thread; }
+
+	// Drops the recorded iterations once they are written; only the summary remains valid.
+	void releaseRecords() {
+		vector<double>().swap(timestamps);
+		vector<int>().swap(recordedPopulations);
+	}
+
+private:
+
+	// Private helper functions.
+	void updateAllChances();
+
+	const void outputHeader(ostream& cout, string format, const int initialPopulations[]);
+	const void outputRecords(ostream& cout, string format);
+
+	void recordPopulations(double timestamp, const vector<int>& recorded) {
+		timestamps.push_back(timestamp);
+		recordedPopulations.insert(recordedPopulations.end(), recorded.begin(), recorded.end());
+		if (trajectoryStream.isStreaming() && TrajectoryStream::isChunkFull(timestamps.size())) {
+			flushRecords();
+		}
+	}
+	void flushRecords();
+
+private:
+
+	int id;
+	int threadID = 0;
+
+	const ReactionNetwork* network;
+
+	// Random number stream of this simulation.
+	RandomGenerator rng;
+
+	// Sampled rate parameters and the changeable populations.
+	vector<double> parameters;
+	vector<int> populations;
+	int totalPopulation;
+
+	// Reaction chances, kept up to date incrementally. The running total is resummed periodically.
+	static const int RESUMMATION_INTERVAL = 4096;
+	vector<double> reactionChances;
+	double chancesTotal = 0;
+	bool chancesStale = true;
+	int stepsSinceResummation = 0;
+
+	// Tracked data.
+	vector<long long> firingCounts;
+	long long searchDepth = 0;
+
+	// Recorded data: one timestamp and one row of populations per iteration (or per grid point).
+	vector<double> timestamps;
+	vector<int> recordedPopulations;
+	double endTime = 0;
+
+	// Fixed sampling grid (null when every step is recorded), the next grid point to record and the populations
+	// held since the last step.
+	const vector<double>* samplingTimes = nullptr;
+	size_t nextSample = 0;
+	vector<int> heldPopulations;
+
+	// Output file.
+	TrajectoryStream trajectoryStream;
+};
+
+#endif
@@ -0,0 +1,68 @@
+#include "NextReactionEngine.h"
+
+#include <limits>
+
+double NextReactionEngine::step(SimulationInfo& simulation, double currentTime) {
+
+	// Draw fresh firing times for all events at the start and after interventions changed the populations.
+	if (simulation.chancesStale) {
+		simulation.updateProbabilities();
+		schedulePutativeTimes(simulation, currentTime);
+	}
+
+	int firedEvent = putativeTimes.top();
+	double firingTime = putativeTimes.topKey();
+
+	// The putative times are drawn again from the intervention time, since the intervention marks the chances stale.
+	if (firingTime > simulation.nextInterventionTime) {
+		return simulation.applyScheduledInterventions();
+	}
+
+	if (firingTime == numeric_limits<double>::infinity()) {
+		return firingTime;
+	}
+
+	simulation.processOccurred((SimulationInfo::ElementaryEvent)firedEvent);
+	simulation.lastEvent = SimulationInfo::NO_EVENT;
+
+	// Rescale the remaining waiting times of the dependent events instead of drawing new random numbers.
+	for (int i = 0; i < simulation.dependentEventCount[firedEvent]; i++) {
+		int dependentEvent = simulation.dependentEvents[firedEvent][i];
+		double oldChance = simulation.elementaryEventChances[dependentEvent];
+		double newChance = simulation.elementaryEventChance(dependentEvent);
+		simulation.elementaryEventChances[dependentEvent] = newChance;
+
+		if (dependentEvent == firedEvent) {
+			continue;
+		}
+
+		if (newChance == 0) {
+			putativeTimes.update(dependentEvent, numeric_limits<double>::infinity());
+		}
+		else if (oldChance == 0) {
+			putativeTimes.update(dependentEvent, firingTime + simulation.rng.nextExponential(newChance));
+		}
+		else {
+			double remainingTime = putativeTimes.getKey(dependentEvent) - firingTime;
+			putativeTimes.update(dependentEvent, firingTime + remainingTime * oldChance / newChance);
+		}
+	}
+
+	// The fired event is the only one which needs a new random number.
+	double firedChance = simulation.elementaryEventChance(firedEvent);
+	simulation.elementaryEventChances[firedEvent] = firedChance;
+	putativeTimes.update(firedEvent, firedChance > 0 ? firingTime + simulation.rng.nextExponential(firedChance) : numeric_limits<double>::infinity());
+
+	return firingTime;
+}
+
+void NextReactionEngine::schedulePutativeTimes(SimulationInfo& simulation, double currentTime) {
+	for (int i = 0; i < SimulationInfo::ELEMENTARY_EVENT_COUNT; i++) {
+		if (simulation.elementaryEventChances[i] > 0) {
+			putativeTimes.update(i, currentTime + simulation.rng.nextExponential(simulation.elementaryEventChances[i]));
+		}
+		else {
+			putativeTimes.update(i, numeric_limits<double>::infinity());
+		}
+	}
+}
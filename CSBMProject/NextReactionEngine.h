@@ -0,0 +1,24 @@
+#ifndef _NEXTREACTIONENGINE_H_
+
+#define _NEXTREACTIONENGINE_H_
+
+#include "StepEngine.h"
+#include "SimulationInfo.h"
+#include "IndexedPriorityQueue.h"
+
+// Next reaction method (Gibson and Bruck). The absolute putative firing time of each elementary event is kept in
+// an indexed priority queue; after an event fired, only the times of the events depending on it are rescaled.
+class NextReactionEngine : public StepEngine {
+
+public:
+
+	double step(SimulationInfo& simulation, double currentTime) override;
+
+private:
+
+	void schedulePutativeTimes(SimulationInfo& simulation, double currentTime);
+
+	IndexedPriorityQueue putativeTimes = IndexedPriorityQueue(SimulationInfo::ELEMENTARY_EVENT_COUNT);
+};
+
+#endif
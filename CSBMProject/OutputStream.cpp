@@ -0,0 +1,172 @@
+#include "OutputStream.h"
+
+#ifdef CSBM_WITH_ZLIB
+#include <zlib.h>
+#endif
+#ifdef CSBM_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+void OutputStream::open(const string& filename, ios::openmode mode, Configuration::OutputCompression compression, int level) {
+	close();
+
+	if (compression == Configuration::OutputCompression::NO_COMPRESSION) {
+		file.open(filename, mode);
+		rdbuf(file.rdbuf());
+		return;
+	}
+
+	file.open(filename + getExtension(compression), mode | ios::binary);
+	chunkBuffer.start(&file, compression, level);
+	compressing = true;
+	rdbuf(&chunkBuffer);
+}
+
+void OutputStream::attach(ostream& target, Configuration::OutputCompression compression, int level) {
+	close();
+
+	if (compression == Configuration::OutputCompression::NO_COMPRESSION) {
+		rdbuf(target.rdbuf());
+		return;
+	}
+
+	chunkBuffer.start(&target, compression, level);
+	compressing = true;
+	rdbuf(&chunkBuffer);
+}
+
+void OutputStream::close() {
+	if (compressing) {
+		chunkBuffer.finish();
+		compressing = false;
+	}
+	if (file.is_open()) {
+		file.close();
+	}
+	rdbuf(nullptr);
+}
+
+bool OutputStream::isAvailable(Configuration::OutputCompression compression) {
+	switch (compression) {
+	case Configuration::OutputCompression::GZIP:
+#ifdef CSBM_WITH_ZLIB
+		return true;
+#else
+		return false;
+#endif
+	case Configuration::OutputCompression::ZSTD:
+#ifdef CSBM_WITH_ZSTD
+		return true;
+#else
+		return false;
+#endif
+	default:
+		return true;
+	}
+}
+
+int OutputStream::getMaximumLevel(Configuration::OutputCompression compression) {
+	switch (compression) {
+	case Configuration::OutputCompression::GZIP:
+		return 9;
+	case Configuration::OutputCompression::ZSTD:
+		return 22;
+	default:
+		return 0;
+	}
+}
+
+const string OutputStream::getExtension(Configuration::OutputCompression compression) {
+	switch (compression) {
+	case Configuration::OutputCompression::GZIP:
+		return ".gz";
+	case Configuration::OutputCompression::ZSTD:
+		return ".zst";
+	default:
+		return "";
+	}
+}
+
+void OutputStream::compressChunk(const char* data, size_t size, Configuration::OutputCompression compression, int level, string& compressed) {
+
+#ifdef CSBM_WITH_ZLIB
+	if (compression == Configuration::OutputCompression::GZIP) {
+		size_t start = compressed.size();
+		z_stream stream = {};
+
+		// A window of 15 bits plus 16 selects the gzip wrapper.
+		if (deflateInit2(&stream, level == 0 ? Z_DEFAULT_COMPRESSION : level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+			cerr << "ERROR: Cannot start the gzip compression of an output file." << endl;
+			exit(1);
+		}
+
+		compressed.resize(start + deflateBound(&stream, (uLong)size));
+		stream.next_in = (Bytef*)data;
+		stream.avail_in = (uInt)size;
+		stream.next_out = (Bytef*)&compressed[start];
+		stream.avail_out = (uInt)(compressed.size() - start);
+
+		// The output has room for the bound, so the whole chunk is compressed by one call.
+		int result = deflate(&stream, Z_FINISH);
+		compressed.resize(start + stream.total_out);
+		if (deflateEnd(&stream) != Z_OK || result != Z_STREAM_END) {
+			cerr << "ERROR: The gzip compression of an output file failed." << endl;
+			exit(1);
+		}
+		return;
+	}
+#endif
+
+#ifdef CSBM_WITH_ZSTD
+	if (compression == Configuration::OutputCompression::ZSTD) {
+		size_t start = compressed.size();
+		compressed.resize(start + ZSTD_compressBound(size));
+		size_t written = ZSTD_compress(&compressed[start], compressed.size() - start, data, size, level == 0 ? ZSTD_CLEVEL_DEFAULT : level);
+		if (ZSTD_isError(written)) {
+			cerr << "ERROR: The zstd compression of an output file failed: " << ZSTD_getErrorName(written) << endl;
+			exit(1);
+		}
+		compressed.resize(start + written);
+		return;
+	}
+#endif
+
+	// Unused when the build has no compression library.
+	(void)compression;
+	(void)level;
+
+	// The parser only accepts the compressions of this build, so there is nothing else to handle.
+	compressed.append(data, size);
+}
+
+void OutputStream::ChunkBuffer::start(ostream* chunkTarget, Configuration::OutputCompression chunkCompression, int chunkLevel) {
+	target = chunkTarget;
+	compression = chunkCompression;
+	level = chunkLevel;
+
+	chunk.resize(CHUNK_SIZE);
+	setp(chunk.data(), chunk.data() + chunk.size());
+}
+
+OutputStream::ChunkBuffer::int_type OutputStream::ChunkBuffer::overflow(int_type character) {
+	writeChunk();
+
+	if (!traits_type::eq_int_type(character, traits_type::eof())) {
+		*pptr() = traits_type::to_char_type(character);
+		pbump(1);
+	}
+	return traits_type::not_eof(character);
+}
+
+void OutputStream::ChunkBuffer::writeChunk() {
+	size_t size = pptr() - pbase();
+	if (size == 0) {
+		return;
+	}
+
+	compressed.clear();
+	compressChunk(pbase(), size, compression, level, compressed);
+	target->write(compressed.data(), compressed.size());
+
+	setp(chunk.data(), chunk.data() + chunk.size());
+}
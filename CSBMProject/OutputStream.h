@@ -0,0 +1,86 @@
+#ifndef _OUTPUTSTREAM_H_
+
+#define _OUTPUTSTREAM_H_
+
+#include <ostream>
+#include <fstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "Configuration.h"
+
+using namespace std;
+
+// An output stream to a file or to another stream, which compresses what is written to it when asked to.
+// The data is compressed in independent chunks of CHUNK_SIZE bytes, each a complete gzip member or zstd frame,
+// so a file holds a sequence of them and is read as a whole by the standard tools (gzip -d, zstd -d). Without
+// compression, the stream writes straight to the file or the other stream.
+//
+// The compression libraries are optional: gzip is available when the program is built with CSBM_WITH_ZLIB
+// defined and zlib linked, and zstd with CSBM_WITH_ZSTD defined and libzstd linked.
+class OutputStream : public ostream {
+
+public:
+
+	static const size_t CHUNK_SIZE = 1 << 20;
+
+	// Constructor.
+	OutputStream() : ostream(nullptr) {}
+	~OutputStream() { close(); }
+
+	// Opens a file. A compressed file is always binary, and the extension of the compression is added to its name.
+	// A level of 0 selects the default level of the compression.
+	void open(const string& filename, ios::openmode mode, Configuration::OutputCompression compression, int level = 0);
+
+	// Writes to another stream instead of a file.
+	void attach(ostream& target, Configuration::OutputCompression compression, int level = 0);
+
+	// Compresses the rest of the data and closes the file.
+	void close();
+
+	// Whether the compression is available in this build.
+	static bool isAvailable(Configuration::OutputCompression compression);
+
+	// Highest level of the compression (0 without compression).
+	static int getMaximumLevel(Configuration::OutputCompression compression);
+
+	// File name extension of the compression (empty without compression).
+	static const string getExtension(Configuration::OutputCompression compression);
+
+	// Compresses the data as one gzip member or zstd frame and appends it to compressed.
+	static void compressChunk(const char* data, size_t size, Configuration::OutputCompression compression, int level, string& compressed);
+
+private:
+
+	// Collects the data of a chunk and writes it compressed to the target once it is full.
+	class ChunkBuffer : public streambuf {
+
+	public:
+
+		void start(ostream* target, Configuration::OutputCompression compression, int level);
+		void finish() { writeChunk(); }
+
+	protected:
+
+		int_type overflow(int_type character) override;
+
+	private:
+
+		void writeChunk();
+
+		ostream* target = nullptr;
+		Configuration::OutputCompression compression;
+		int level;
+
+		// The chunk and its compressed form, both kept for the next chunks.
+		vector<char> chunk;
+		string compressed;
+	};
+
+	ofstream file;
+	ChunkBuffer chunkBuffer;
+	bool compressing = false;
+};
+
+#endif
@@ -0,0 +1,88 @@
+#include "OutputWriter.h"
+
+#include <chrono>
+
+// Waiting threads spin briefly and then sleep for a short while between attempts.
+static const int SPIN_ATTEMPTS = 64;
+static const std::chrono::microseconds WAIT_INTERVAL(50);
+
+OutputWriter::OutputWriter(int writerCount, string outputFormat, SegmentedOutput* segments) :
+	queue(QUEUE_CAPACITY), format(outputFormat), segments(segments), writerCount(writerCount) {
+	for (int i = 0; i < writerCount; i++) {
+		writers.push_back(thread(&OutputWriter::writeLoop, this));
+	}
+}
+
+void OutputWriter::submit(const Job& job) {
+
+	if (!queue.tryPush(job)) {
+		auto blockedSince = std::chrono::steady_clock::now();
+
+		int attempts = 0;
+		while (!queue.tryPush(job)) {
+			if (++attempts < SPIN_ATTEMPTS) {
+				this_thread::yield();
+			}
+			else {
+				this_thread::sleep_for(WAIT_INTERVAL);
+			}
+		}
+
+		blockedNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - blockedSince).count();
+	}
+
+	size_t depth = queue.size();
+	submittedCount++;
+	queueDepthTotal += depth;
+
+	size_t maximum = maximumQueueDepth.load();
+	while (depth > maximum && !maximumQueueDepth.compare_exchange_weak(maximum, depth)) {
+	}
+}
+
+void OutputWriter::finish() {
+	finished = true;
+	for (thread& writer : writers) {
+		writer.join();
+	}
+	writers.clear();
+}
+
+const double OutputWriter::getMeanQueueDepth() {
+	long long count = submittedCount.load();
+	return count > 0 ? (double)queueDepthTotal.load() / count : 0;
+}
+
+void OutputWriter::writeLoop() {
+
+	int attempts = 0;
+
+	while (true) {
+		Job job;
+
+		if (!queue.tryPop(job)) {
+			// The queue is only drained for good once no more simulations are submitted.
+			if (finished && queue.size() == 0) {
+				return;
+			}
+			if (++attempts < SPIN_ATTEMPTS) {
+				this_thread::yield();
+			}
+			else {
+				this_thread::sleep_for(WAIT_INTERVAL);
+			}
+			continue;
+		}
+
+		attempts = 0;
+
+		if (job.simulation != nullptr) {
+			job.simulation->outputToFile(format, segments);
+			job.simulation->releaseRecords();
+		}
+		else {
+			job.networkSimulation->outputToFile(format, segments);
+			job.networkSimulation->releaseRecords();
+		}
+	}
+}
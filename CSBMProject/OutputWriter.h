@@ -0,0 +1,72 @@
+#ifndef _OUTPUTWRITER_H_
+
+#define _OUTPUTWRITER_H_
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+
+#include "BoundedQueue.h"
+#include "SimulationInfo.h"
+#include "NetworkSimulation.h"
+
+using namespace std;
+
+// Writes the output files of finished simulations on dedicated threads, so the simulation threads do not wait
+// for the formatting and the file system. The simulations are handed over through a bounded queue; a simulation
+// thread submitting to a full queue waits until a writer takes a simulation out of it, which bounds the number
+// of finished trajectories kept in memory. Each simulation releases its records once its file is written.
+class OutputWriter {
+
+public:
+
+	static const int QUEUE_CAPACITY = 64;
+
+	// Constructor. Starts the writer threads. With segments, the trajectories are appended to the segment files.
+	OutputWriter(int writerCount, string outputFormat, SegmentedOutput* segments = nullptr);
+	~OutputWriter() { finish(); }
+
+	OutputWriter(const OutputWriter&) = delete;
+	OutputWriter& operator=(const OutputWriter&) = delete;
+
+	// Queues the simulation for output, waiting while the queue is full.
+	void submit(SimulationInfo* simulation) { submit(Job{ simulation, nullptr }); }
+	void submit(NetworkSimulation* simulation) { submit(Job{ nullptr, simulation }); }
+
+	// Waits until every submitted simulation is written and stops the writer threads.
+	void finish();
+
+	// Metrics.
+	const int getWriterCount() { return writerCount; }
+	const long long getSubmittedCount() { return submittedCount.load(); }
+	const size_t getMaximumQueueDepth() { return maximumQueueDepth.load(); }
+	const double getMeanQueueDepth();
+	const double getBlockedSeconds() { return blockedNanoseconds.load() * 1e-9; }
+
+private:
+
+	struct Job {
+		SimulationInfo* simulation;
+		NetworkSimulation* networkSimulation;
+	};
+
+	void submit(const Job& job);
+	void writeLoop();
+
+	BoundedQueue<Job> queue;
+	string format;
+	SegmentedOutput* segments;
+
+	int writerCount;
+	vector<thread> writers;
+	atomic<bool> finished{ false };
+
+	// Queue depth seen by every submission, and the time the simulation threads spent waiting on a full queue.
+	atomic<long long> submittedCount{ 0 };
+	atomic<long long> queueDepthTotal{ 0 };
+	atomic<size_t> maximumQueueDepth{ 0 };
+	atomic<long long> blockedNanoseconds{ 0 };
+};
+
+#endif
@@ -0,0 +1,113 @@
+#include "QuantileSketch.h"
+
+#include <cmath>
+#include <algorithm>
+
+QuantileSketch::QuantileSketch(bool integral) : integral(integral) {
+	double gamma = (1 + RELATIVE_ACCURACY) / (1 - RELATIVE_ACCURACY);
+	logGamma = log(gamma);
+}
+
+int QuantileSketch::findBucket(double value) const {
+	return (int)ceil(log(value) / logGamma);
+}
+
+void QuantileSketch::add(double value) {
+
+	if (count == 0 || value < minimum) {
+		minimum = value;
+	}
+	if (count == 0 || value > maximum) {
+		maximum = value;
+	}
+	count++;
+
+	if (value < MINIMUM_VALUE) {
+		zeroCount++;
+		return;
+	}
+
+	int bucket = findBucket(value);
+
+	// The counters grow to cover the buckets of the values added so far.
+	if (buckets.empty()) {
+		firstBucket = bucket;
+		buckets.push_back(0);
+	}
+	else if (bucket < firstBucket) {
+		buckets.insert(buckets.begin(), firstBucket - bucket, 0);
+		firstBucket = bucket;
+	}
+	else if (bucket >= firstBucket + (int)buckets.size()) {
+		buckets.resize(bucket - firstBucket + 1, 0);
+	}
+
+	buckets[bucket - firstBucket]++;
+}
+
+void QuantileSketch::merge(const QuantileSketch& other) {
+
+	if (other.count == 0) {
+		return;
+	}
+
+	if (count == 0 || other.minimum < minimum) {
+		minimum = other.minimum;
+	}
+	if (count == 0 || other.maximum > maximum) {
+		maximum = other.maximum;
+	}
+	count += other.count;
+	zeroCount += other.zeroCount;
+
+	if (other.buckets.empty()) {
+		return;
+	}
+	if (buckets.empty()) {
+		firstBucket = other.firstBucket;
+		buckets = other.buckets;
+		return;
+	}
+
+	int first = min(firstBucket, other.firstBucket);
+	int last = max(firstBucket + (int)buckets.size(), other.firstBucket + (int)other.buckets.size());
+	if (first < firstBucket) {
+		buckets.insert(buckets.begin(), firstBucket - first, 0);
+		firstBucket = first;
+	}
+	buckets.resize(last - firstBucket, 0);
+
+	for (size_t i = 0; i < other.buckets.size(); i++) {
+		buckets[other.firstBucket - firstBucket + i] += other.buckets[i];
+	}
+}
+
+const double QuantileSketch::getQuantile(double fraction) const {
+
+	if (count == 0) {
+		return 0;
+	}
+
+	// The value of the given rank among the added values, in ascending order.
+	long long rank = (long long)(fraction * (count - 1));
+	double estimate = maximum;
+
+	if (rank < zeroCount) {
+		estimate = 0;
+	}
+	else {
+		long long seen = zeroCount;
+		for (size_t i = 0; i < buckets.size(); i++) {
+			seen += buckets[i];
+			if (seen > rank) {
+				// The middle of the bucket in relative terms, which is within the accuracy of all its values.
+				double gamma = exp(logGamma);
+				estimate = 2 * exp(logGamma * (firstBucket + (int)i)) / (gamma + 1);
+				break;
+			}
+		}
+	}
+
+	estimate = min(max(estimate, minimum), maximum);
+	return integral ? round(estimate) : estimate;
+}
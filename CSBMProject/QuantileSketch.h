@@ -0,0 +1,59 @@
+#ifndef _QUANTILESKETCH_H_
+
+#define _QUANTILESKETCH_H_
+
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+// Mergeable sketch of the distribution of non-negative values, which estimates any quantile with a relative error
+// of at most RELATIVE_ACCURACY (the logarithmic buckets of DDSketch). The buckets cover the values from
+// MINIMUM_VALUE to the largest double in at most a few thousand counters, so the memory is bounded whatever the
+// number of values added; smaller values are counted as zero. Sketches filled by different threads are merged by
+// adding their counters, which gives the same sketch as adding all values to one. For integral values, the
+// estimates are rounded, which makes them exact up to 1 / (2 * RELATIVE_ACCURACY).
+class QuantileSketch {
+
+public:
+
+	static constexpr double RELATIVE_ACCURACY = 0.01;
+	static constexpr double MINIMUM_VALUE = 1e-9;
+
+	// The quantiles written to the output files, and their column names.
+	static constexpr int REPORTED_QUANTILE_COUNT = 5;
+	static constexpr double REPORTED_QUANTILES[REPORTED_QUANTILE_COUNT] = { 0.05, 0.25, 0.5, 0.75, 0.95 };
+	static constexpr const char* REPORTED_QUANTILE_NAMES[REPORTED_QUANTILE_COUNT] = { "P5", "P25", "P50", "P75", "P95" };
+
+	// Constructor.
+	QuantileSketch(bool integral = false);
+
+	void add(double value);
+
+	// Adds the values added to other, as if they had been added to this sketch.
+	void merge(const QuantileSketch& other);
+
+	// Getter methods. The quantile is estimated for a fraction between 0 and 1; the extremes are exact.
+	const long long getCount() const { return count; }
+	const double getMinimum() const { return minimum; }
+	const double getMaximum() const { return maximum; }
+	const double getQuantile(double fraction) const;
+
+private:
+
+	int findBucket(double value) const;
+
+	bool integral;
+	double logGamma;
+
+	long long count = 0;
+	long long zeroCount = 0;
+	double minimum = 0;
+	double maximum = 0;
+
+	// Counters of the buckets firstBucket, firstBucket + 1, ... Bucket i holds the values in (gamma^(i-1), gamma^i].
+	int firstBucket = 0;
+	vector<long long> buckets;
+};
+
+#endif
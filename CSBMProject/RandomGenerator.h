@@ -0,0 +1,236 @@
+#ifndef _RANDOMGENERATOR_H_
+
+#define _RANDOMGENERATOR_H_
+
+#include <cstdint>
+#include <cmath>
+
+// A counter-based Philox4x32-10 random number generator.
+// Every stream is keyed by the master seed and identified by the simulation ID, so a simulation
+// draws the same sequence of numbers no matter which thread executes it. The class satisfies the
+// UniformRandomBitGenerator requirements and can be passed to the <random> distributions.
+class RandomGenerator {
+
+	// The variate buffer generates whole blocks of the stream with its own vectorized kernel.
+	friend class VariateBuffer;
+
+public:
+
+	typedef uint64_t result_type;
+
+	// Constructor.
+	RandomGenerator(uint64_t seed = 0, uint64_t streamID = 0) {
+		key[0] = uint32_t(seed & 0xffffffff);
+		key[1] = uint32_t(seed >> 32);
+
+		counter[0] = 0;
+		counter[1] = 0;
+		counter[2] = uint32_t(streamID & 0xffffffff);
+		counter[3] = uint32_t(streamID >> 32);
+
+		outputPosition = OUTPUT_SIZE;
+	}
+
+	static constexpr result_type min() { return 0; }
+	static constexpr result_type max() { return UINT64_MAX; }
+
+	// Returns the next 64 random bits of the stream.
+	result_type operator()() {
+		if (outputPosition == OUTPUT_SIZE) {
+			generateBlock();
+		}
+		return output[outputPosition++];
+	}
+
+	// Returns a uniformly distributed number in [0, 1).
+	double nextUniform() {
+		return ((*this)() >> 11) * (1.0 / 9007199254740992.0);
+	}
+
+	// Fills the destination with the next count uniforms of the stream; same numbers as count calls of nextUniform().
+	// Whole blocks are generated BULK_BLOCKS at a time, with every round applied to all of them in a loop the
+	// compiler vectorizes.
+	void fillUniforms(double destination[], int count) {
+		int i = 0;
+
+		while (i < count && outputPosition != OUTPUT_SIZE) {
+			destination[i++] = nextUniform();
+		}
+
+		uint64_t blockIndex = (uint64_t(counter[1]) << 32) | counter[0];
+
+		while (count - i >= OUTPUT_SIZE * BULK_BLOCKS) {
+			uint32_t block0[BULK_BLOCKS], block1[BULK_BLOCKS], block2[BULK_BLOCKS], block3[BULK_BLOCKS];
+
+			for (int j = 0; j < BULK_BLOCKS; j++) {
+				block0[j] = uint32_t((blockIndex + j) & 0xffffffff);
+				block1[j] = uint32_t((blockIndex + j) >> 32);
+				block2[j] = counter[2];
+				block3[j] = counter[3];
+			}
+
+			uint32_t roundKey0 = key[0];
+			uint32_t roundKey1 = key[1];
+
+			for (int round = 0; round < ROUNDS; round++) {
+				for (int j = 0; j < BULK_BLOCKS; j++) {
+					uint64_t product0 = uint64_t(MULTIPLIER_0) * block0[j];
+					uint64_t product1 = uint64_t(MULTIPLIER_1) * block2[j];
+
+					block0[j] = uint32_t(product1 >> 32) ^ block1[j] ^ roundKey0;
+					block1[j] = uint32_t(product1);
+					block2[j] = uint32_t(product0 >> 32) ^ block3[j] ^ roundKey1;
+					block3[j] = uint32_t(product0);
+				}
+
+				roundKey0 += WEYL_0;
+				roundKey1 += WEYL_1;
+			}
+
+			for (int j = 0; j < BULK_BLOCKS; j++) {
+				destination[i + 2 * j] = wordsToUniform(block1[j], block0[j]);
+				destination[i + 2 * j + 1] = wordsToUniform(block3[j], block2[j]);
+			}
+
+			blockIndex += BULK_BLOCKS;
+			i += OUTPUT_SIZE * BULK_BLOCKS;
+		}
+
+		counter[0] = uint32_t(blockIndex & 0xffffffff);
+		counter[1] = uint32_t(blockIndex >> 32);
+
+		while (i < count) {
+			destination[i++] = nextUniform();
+		}
+	}
+
+	// Returns an exponentially distributed number with the given rate (inversion method).
+	double nextExponential(double rate) {
+		return -std::log(1.0 - nextUniform()) / rate;
+	}
+
+	// Returns a standard normally distributed number (Box-Muller, the second variate is kept for the next call).
+	double nextNormal() {
+		if (hasSpareNormal) {
+			hasSpareNormal = false;
+			return spareNormal;
+		}
+
+		double radius = std::sqrt(-2.0 * std::log(1.0 - nextUniform()));
+		double angle = 6.283185307179586 * nextUniform();
+
+		spareNormal = radius * std::sin(angle);
+		hasSpareNormal = true;
+		return radius * std::cos(angle);
+	}
+
+	// Returns a Poisson distributed number with the given mean.
+	// Small means use sequential inversion, large means Hormann's transformed rejection (PTRS).
+	long long nextPoisson(double mean) {
+		if (mean <= 0) {
+			return 0;
+		}
+
+		if (mean < 10) {
+			double u = nextUniform();
+			double probability = std::exp(-mean);
+			double cumulative = probability;
+			long long k = 0;
+			while (u > cumulative && probability > 0) {
+				k++;
+				probability *= mean / k;
+				cumulative += probability;
+			}
+			return k;
+		}
+
+		double rootMean = std::sqrt(mean);
+		double logMean = std::log(mean);
+		double b = 0.931 + 2.53 * rootMean;
+		double a = -0.059 + 0.02483 * b;
+		double inverseAlpha = 1.1239 + 1.1328 / (b - 3.4);
+		double vr = 0.9277 - 3.6224 / (b - 2);
+
+		while (true) {
+			double u = nextUniform() - 0.5;
+			double v = nextUniform();
+			double us = 0.5 - std::fabs(u);
+			long long k = (long long)std::floor((2 * a / us + b) * u + mean + 0.43);
+
+			if (us >= 0.07 && v <= vr) {
+				return k;
+			}
+			if (k < 0 || (us < 0.013 && v > us)) {
+				continue;
+			}
+			if (std::log(v) + std::log(inverseAlpha) - std::log(a / (us * us) + b) <= -mean + k * logMean - std::lgamma(k + 1.0)) {
+				return k;
+			}
+		}
+	}
+
+private:
+
+	static const int OUTPUT_SIZE = 2;
+	static const int ROUNDS = 10;
+	static const int BULK_BLOCKS = 8;
+
+	static const uint32_t MULTIPLIER_0 = 0xD2511F53;
+	static const uint32_t MULTIPLIER_1 = 0xCD9E8D57;
+	static const uint32_t WEYL_0 = 0x9E3779B9;
+	static const uint32_t WEYL_1 = 0xBB67AE85;
+
+	// Same number as nextUniform() makes of the 64 bits (upper << 32) | lower, computed with 32-bit conversions only
+	// (which vectorize, unlike 64-bit ones). Every partial result is exact, so the values are identical.
+	static double wordsToUniform(uint32_t upper, uint32_t lower) {
+		uint32_t high = upper >> 11;
+		uint32_t low = (upper << 21) | (lower >> 11);
+		double lowValue = (double)(int32_t)(low ^ 0x80000000) + 2147483648.0;
+		return ((double)(int32_t)high * 4294967296.0 + lowValue) * (1.0 / 9007199254740992.0);
+	}
+
+	// Encrypts the current counter with the key and advances the counter by one block.
+	void generateBlock() {
+		uint32_t block[4] = { counter[0], counter[1], counter[2], counter[3] };
+		uint32_t roundKey[2] = { key[0], key[1] };
+
+		for (int round = 0; round < ROUNDS; round++) {
+			uint64_t product0 = uint64_t(MULTIPLIER_0) * block[0];
+			uint64_t product1 = uint64_t(MULTIPLIER_1) * block[2];
+
+			uint32_t next[4];
+			next[0] = uint32_t(product1 >> 32) ^ block[1] ^ roundKey[0];
+			next[1] = uint32_t(product1);
+			next[2] = uint32_t(product0 >> 32) ^ block[3] ^ roundKey[1];
+			next[3] = uint32_t(product0);
+
+			block[0] = next[0];
+			block[1] = next[1];
+			block[2] = next[2];
+			block[3] = next[3];
+
+			roundKey[0] += WEYL_0;
+			roundKey[1] += WEYL_1;
+		}
+
+		output[0] = (uint64_t(block[1]) << 32) | block[0];
+		output[1] = (uint64_t(block[3]) << 32) | block[2];
+		outputPosition = 0;
+
+		// The lower half of the counter is the block index, the upper half identifies the stream.
+		if (++counter[0] == 0) {
+			counter[1]++;
+		}
+	}
+
+	uint32_t key[2];
+	uint32_t counter[4];
+
+	uint64_t output[OUTPUT_SIZE];
+	int outputPosition;
+
+	double spareNormal = 0;
+	bool hasSpareNormal = false;
+};
+
+#endif
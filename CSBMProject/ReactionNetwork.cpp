@@ -0,0 +1,103 @@
+#include "ReactionNetwork.h"
+
+int ReactionNetwork::addCompartment(string name, int lowerBound, int upperBound, bool infectious) {
+	compartmentNames.push_back(name);
+	compartmentBoundaries.push_back({ lowerBound, upperBound });
+	infectiousCompartments.push_back(infectious);
+	return (int)compartmentNames.size() - 1;
+}
+
+int ReactionNetwork::addParameter(string name, double lowerBound, double upperBound) {
+	parameterNames.push_back(name);
+	parameterBoundaries.push_back({ lowerBound, upperBound });
+	return (int)parameterNames.size() - 1;
+}
+
+void ReactionNetwork::addReaction(string name, RateLaw rateLaw, int rateParameter, vector<pair<int, int>> reactants, vector<pair<int, int>> products) {
+	reactionNames.push_back(name);
+	rateLaws.push_back(rateLaw);
+	rateParameters.push_back(rateParameter);
+	reactionReactants.push_back(reactants);
+	reactionProducts.push_back(products);
+}
+
+int ReactionNetwork::findCompartment(string name) const {
+	for (unsigned i = 0; i < compartmentNames.size(); i++) {
+		if (compartmentNames[i] == name) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+int ReactionNetwork::findParameter(string name) const {
+	for (unsigned i = 0; i < parameterNames.size(); i++) {
+		if (parameterNames[i] == name) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+void ReactionNetwork::compile() {
+
+	int reactionCount = getReactionCount();
+	int compartmentCount = getCompartmentCount();
+
+	reactionOrders.assign(reactionCount, 0);
+	reactantStart.assign(1, 0);
+	reactantCompartments.clear();
+	reactantOrders.clear();
+	changeStart.assign(1, 0);
+	changeCompartments.clear();
+	changeAmounts.clear();
+
+	// Population changes per reaction, used to build the dependency graph.
+	vector<vector<int>> stoichiometry(reactionCount, vector<int>(compartmentCount, 0));
+	vector<int> totalChange(reactionCount, 0);
+
+	for (int i = 0; i < reactionCount; i++) {
+		for (auto& reactant : reactionReactants[i]) {
+			reactantCompartments.push_back(reactant.first);
+			reactantOrders.push_back(reactant.second);
+			reactionOrders[i] += reactant.second;
+			stoichiometry[i][reactant.first] -= reactant.second;
+		}
+		reactantStart.push_back((int)reactantCompartments.size());
+
+		for (auto& product : reactionProducts[i]) {
+			stoichiometry[i][product.first] += product.second;
+		}
+
+		for (int j = 0; j < compartmentCount; j++) {
+			if (stoichiometry[i][j] != 0) {
+				changeCompartments.push_back(j);
+				changeAmounts.push_back(stoichiometry[i][j]);
+				totalChange[i] += stoichiometry[i][j];
+			}
+		}
+		changeStart.push_back((int)changeCompartments.size());
+	}
+
+	// A reaction depends on another if it reads a compartment the other one changes, or if it is
+	// frequency dependent and the other one changes the total population.
+	dependentStart.assign(1, 0);
+	dependentReactions.clear();
+
+	for (int i = 0; i < reactionCount; i++) {
+		for (int k = 0; k < reactionCount; k++) {
+			bool dependent = rateLaws[k] == FREQUENCY_DEPENDENT && totalChange[i] != 0;
+
+			for (int r = reactantStart[k]; r < reactantStart[k + 1]; r++) {
+				if (stoichiometry[i][reactantCompartments[r]] != 0) {
+					dependent = true;
+				}
+			}
+
+			if (dependent) {
+				dependentReactions.push_back(k);
+			}
+		}
+		dependentStart.push_back((int)dependentReactions.size());
+	}
+}
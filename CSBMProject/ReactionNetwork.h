@@ -0,0 +1,120 @@
+#ifndef _REACTIONNETWORK_H_
+
+#define _REACTIONNETWORK_H_
+
+#include <vector>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+// A reaction network made of compartments, rate parameters and reactions between the compartments.
+// After compile() is called, the reactions are stored in flat tables (reactants, population changes and
+// the dependency graph) which the network engine walks without any further indirection.
+class ReactionNetwork {
+
+public:
+
+	// The supported rate laws.
+	enum RateLaw {
+		// rate * product of the reactant populations (falling factorials for reactants of higher order).
+		MASS_ACTION,
+		// rate * product of the reactant populations / total population^(order - 1).
+		FREQUENCY_DEPENDENT
+	};
+
+	// Building methods.
+	int addCompartment(string name, int lowerBound, int upperBound, bool infectious);
+	int addParameter(string name, double lowerBound, double upperBound);
+	void addReaction(string name, RateLaw rateLaw, int rateParameter, vector<pair<int, int>> reactants, vector<pair<int, int>> products);
+
+	// Builds the flat reaction table and the dependency graph. Must be called after the last reaction is added.
+	void compile();
+
+	// Lookup methods. Return -1 if the name is unknown.
+	int findCompartment(string name) const;
+	int findParameter(string name) const;
+
+	// Getter methods.
+	int getCompartmentCount() const { return (int)compartmentNames.size(); }
+	int getParameterCount() const { return (int)parameterNames.size(); }
+	int getReactionCount() const { return (int)reactionNames.size(); }
+
+	string getCompartmentName(int compartment) const { return compartmentNames[compartment]; }
+	string getParameterName(int parameter) const { return parameterNames[parameter]; }
+	string getReactionName(int reaction) const { return reactionNames[reaction]; }
+
+	vector<int> getCompartmentBoundaries(int compartment) const { return compartmentBoundaries[compartment]; }
+	vector<double> getParameterBoundaries(int parameter) const { return parameterBoundaries[parameter]; }
+	bool isInfectious(int compartment) const { return infectiousCompartments[compartment]; }
+
+	// Chance of the given reaction in the given state.
+	double reactionChance(int reaction, const int populations[], int totalPopulation, const double parameters[]) const {
+		double chance = parameters[rateParameters[reaction]];
+
+		for (int i = reactantStart[reaction]; i < reactantStart[reaction + 1]; i++) {
+			int population = populations[reactantCompartments[i]];
+			for (int k = 0; k < reactantOrders[i]; k++) {
+				chance *= population - k;
+			}
+		}
+
+		if (rateLaws[reaction] == FREQUENCY_DEPENDENT) {
+			if (totalPopulation <= 0) {
+				return 0;
+			}
+			for (int k = 1; k < reactionOrders[reaction]; k++) {
+				chance /= totalPopulation;
+			}
+			if (reactionOrders[reaction] == 0) {
+				chance *= totalPopulation;
+			}
+		}
+
+		return chance > 0 ? chance : 0;
+	}
+
+	// Applies the population changes of the given reaction.
+	void applyReaction(int reaction, int populations[], int& totalPopulation) const {
+		for (int i = changeStart[reaction]; i < changeStart[reaction + 1]; i++) {
+			populations[changeCompartments[i]] += changeAmounts[i];
+			totalPopulation += changeAmounts[i];
+		}
+	}
+
+	// Reactions whose chances have to be recomputed after the given reaction occurred.
+	const int* dependentsBegin(int reaction) const { return dependentReactions.data() + dependentStart[reaction]; }
+	const int* dependentsEnd(int reaction) const { return dependentReactions.data() + dependentStart[reaction + 1]; }
+
+private:
+
+	// Model description.
+	vector<string> compartmentNames;
+	vector<vector<int>> compartmentBoundaries;
+	vector<bool> infectiousCompartments;
+
+	vector<string> parameterNames;
+	vector<vector<double>> parameterBoundaries;
+
+	vector<string> reactionNames;
+	vector<vector<pair<int, int>>> reactionReactants;
+	vector<vector<pair<int, int>>> reactionProducts;
+
+	// Flat reaction table, indexed through the *Start offsets (reaction i uses [start[i], start[i + 1])).
+	vector<int> rateLaws;
+	vector<int> rateParameters;
+	vector<int> reactionOrders;
+
+	vector<int> reactantStart;
+	vector<int> reactantCompartments;
+	vector<int> reactantOrders;
+
+	vector<int> changeStart;
+	vector<int> changeCompartments;
+	vector<int> changeAmounts;
+
+	vector<int> dependentStart;
+	vector<int> dependentReactions;
+};
+
+#endif
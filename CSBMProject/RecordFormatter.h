@@ -0,0 +1,205 @@
+#ifndef _RECORDFORMATTER_H_
+
+#define _RECORDFORMATTER_H_
+
+#include <ostream>
+#include <vector>
+#include <charconv>
+#include <cstring>
+#include <cstdint>
+
+using namespace std;
+
+// Formats the records of the TXT and CSV output files into a per-thread buffer, which is written to the stream
+// in blocks of BUFFER_SIZE bytes. The characters are the same as those of the stream operators: a plain number
+// is formatted like "cout << value" with the default precision of 6 digits, and a fixed-point one like
+// "cout << fixed << setprecision(precision)". The padded variants append spaces up to the width, like
+// "setw(width) << left". The buffer belongs to the thread, so only one formatter may be used on a thread at a
+// time; the rest of the buffer is written when the formatter is destroyed.
+//
+// The integers are formatted with std::to_chars. The doubles in the usual range of the timestamps are rounded
+// to an integer count of their last digit, which is printed instead; this is exact unless the rounding is too
+// close to a tie to be decided, and such doubles (like all others) are formatted with std::to_chars.
+class RecordFormatter {
+
+public:
+
+	static const size_t BUFFER_SIZE = 1 << 18;
+
+	// Room reserved for a number: enough for any fixed-point double with a few decimals.
+	static const size_t MAXIMUM_FIELD_SIZE = 384;
+
+	// Constructor.
+	RecordFormatter(ostream& stream) : stream(stream) {
+		thread_local vector<char> threadBuffer(BUFFER_SIZE);
+		begin = position = threadBuffer.data();
+		end = begin + BUFFER_SIZE;
+	}
+	~RecordFormatter() { flush(); }
+
+	RecordFormatter(const RecordFormatter&) = delete;
+	RecordFormatter& operator=(const RecordFormatter&) = delete;
+
+	void append(char character) {
+		reserve(1);
+		*position++ = character;
+	}
+
+	void append(const char* text, size_t length) {
+		reserve(length);
+		memcpy(position, text, length);
+		position += length;
+	}
+
+	// Appends a string literal.
+	template <size_t SIZE>
+	void append(const char (&text)[SIZE]) {
+		append(text, SIZE - 1);
+	}
+
+	void append(int value) {
+		reserve(MAXIMUM_FIELD_SIZE);
+		position = to_chars(position, end, value).ptr;
+	}
+
+	void append(double value) {
+		reserve(MAXIMUM_FIELD_SIZE);
+		position = formatGeneral(position, value);
+	}
+
+	void appendFixed(double value, int precision) {
+		reserve(MAXIMUM_FIELD_SIZE);
+		position = formatFixed(position, value, precision);
+	}
+
+	void appendPadded(int value, int width) {
+		reserve(MAXIMUM_FIELD_SIZE + width);
+		char* start = position;
+		position = to_chars(position, end, value).ptr;
+		pad(start, width);
+	}
+
+	void appendFixedPadded(double value, int precision, int width) {
+		reserve(MAXIMUM_FIELD_SIZE + width);
+		char* start = position;
+		position = formatFixed(position, value, precision);
+		pad(start, width);
+	}
+
+	// Writes the buffered characters to the stream.
+	void flush() {
+		stream.write(begin, position - begin);
+		position = begin;
+	}
+
+private:
+
+	static const int GENERAL_PRECISION = 6;
+	static const int MAXIMUM_FAST_PRECISION = 9;
+
+	// Makes room for size characters, writing the buffer out when it is too full.
+	void reserve(size_t size) {
+		if ((size_t)(end - position) < size) {
+			flush();
+		}
+	}
+
+	// Pads the field starting at start with spaces up to the width (a longer field is kept whole).
+	void pad(char* start, int width) {
+		ptrdiff_t length = position - start;
+		if (length < width) {
+			memset(position, ' ', width - length);
+			position += width - length;
+		}
+	}
+
+	static double powerOfTen(int exponent) {
+		static const double POWERS[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+		return POWERS[exponent];
+	}
+
+	// Rounds value * 10^decimals to the nearest integer. Returns false if the product, which is computed with a
+	// relative error of at most 2^-53, is too close to a tie to tell the direction of the rounding.
+	static bool roundScaled(double value, int decimals, uint64_t& rounded) {
+		double scaled = value * powerOfTen(decimals);
+		rounded = (uint64_t)(scaled + 0.5);
+		double difference = scaled - (double)rounded;
+		double margin = 0.5 - scaled * 2.3e-16;
+		return difference < margin && difference > -margin;
+	}
+
+	// Writes exactly count digits of value, with leading zeros.
+	static char* writeDigits(char* output, uint64_t value, int count) {
+		for (int i = count - 1; i >= 0; i--) {
+			output[i] = (char)('0' + value % 10);
+			value /= 10;
+		}
+		return output + count;
+	}
+
+	// Like printf("%.*f", precision, value).
+	static char* formatFixed(char* output, double value, int precision) {
+		uint64_t rounded;
+		if (value >= 0 && value < 1e9 && precision <= MAXIMUM_FAST_PRECISION && roundScaled(value, precision, rounded)) {
+			uint64_t unit = (uint64_t)powerOfTen(precision);
+			output = to_chars(output, output + MAXIMUM_FIELD_SIZE, rounded / unit).ptr;
+			if (precision > 0) {
+				*output++ = '.';
+				output = writeDigits(output, rounded % unit, precision);
+			}
+			return output;
+		}
+		return to_chars(output, output + MAXIMUM_FIELD_SIZE, value, chars_format::fixed, precision).ptr;
+	}
+
+	// Like printf("%g", value): 6 significant digits without trailing zeros, in fixed notation for the decimal
+	// exponents -4 to 5.
+	static char* formatGeneral(char* output, double value) {
+		if (value >= 1e-4 && value < 1e6) {
+			int exponent = -4;
+			while (exponent < 5 && value >= (exponent + 1 >= 0 ? powerOfTen(exponent + 1) : 1 / powerOfTen(-exponent - 1))) {
+				exponent++;
+			}
+
+			// The rounded value must have exactly 6 digits, otherwise its exponent is not the estimated one.
+			uint64_t rounded;
+			if (roundScaled(value, GENERAL_PRECISION - 1 - exponent, rounded) && rounded >= 100000 && rounded < 1000000) {
+				char digits[GENERAL_PRECISION];
+				writeDigits(digits, rounded, GENERAL_PRECISION);
+
+				int integerDigits = exponent >= 0 ? exponent + 1 : 0;
+				int significant = GENERAL_PRECISION;
+				while (significant > integerDigits && digits[significant - 1] == '0') {
+					significant--;
+				}
+
+				if (exponent < 0) {
+					*output++ = '0';
+					*output++ = '.';
+					for (int i = 0; i < -exponent - 1; i++) {
+						*output++ = '0';
+					}
+					memcpy(output, digits, significant);
+					return output + significant;
+				}
+
+				memcpy(output, digits, integerDigits);
+				output += integerDigits;
+				if (significant > integerDigits) {
+					*output++ = '.';
+					memcpy(output, digits + integerDigits, significant - integerDigits);
+					output += significant - integerDigits;
+				}
+				return output;
+			}
+		}
+		return to_chars(output, output + MAXIMUM_FIELD_SIZE, value, chars_format::general, GENERAL_PRECISION).ptr;
+	}
+
+	ostream& stream;
+	char* begin;
+	char* position;
+	char* end;
+};
+
+#endif
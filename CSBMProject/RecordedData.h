@@ -0,0 +1,25 @@
+#ifndef _RECORDEDDATA_H_
+
+#define _RECORDEDDATA_H_
+
+// A helper structure for holding data of each simulation stage.
+struct RecordedData {
+	double timestamp;
+	int susceptible;
+	int exposed;
+	int infected;
+	int recovered;
+	int total;
+	int births;
+	int deathsSuspectible;
+	int deathsInfected;
+	int deathsRecovered;
+	int deathsDueToInfection;
+	int deathsTotal;
+
+	RecordedData(double time, int S, int E, int I, int R, int N, int born, int diedS, int diedI, int diedR, int diedToInf, int diedTotal) :
+	timestamp(time), susceptible(S), exposed(E), infected(I), recovered(R), total(N), births(born), deathsSuspectible(diedS),
+	deathsInfected(diedI), deathsRecovered(diedR), deathsDueToInfection(diedToInf), deathsTotal(diedTotal) {}
+};
+
+#endif
@@ -0,0 +1,111 @@
+#include "SegmentedOutput.h"
+#include "BinaryTrajectory.h"
+
+#include <cstring>
+
+SegmentedOutput::SegmentedOutput(int segmentCount, string outputFormat, int firstID, int simulationCount) :
+	segments(new Segment[segmentCount]), segmentCount(segmentCount), format(outputFormat), firstID(firstID) {
+
+	for (int i = 0; i < segmentCount; i++) {
+		segments[i].file.open(findSegmentFilename(i, format), ios::binary);
+	}
+
+	// Simulations which are never appended keep an empty entry with the ID -1.
+	SegmentIndexEntry missing;
+	memset(&missing, 0, sizeof(missing));
+	missing.simulationID = -1;
+	missing.segment = -1;
+	entries.assign(simulationCount, missing);
+}
+
+void SegmentedOutput::append(int simulationID, const string& trajectory, double endTime, long long eventCount, const TrajectoryMetrics& metrics) {
+
+	int slot = simulationID - firstID;
+	int segmentIndex = slot % segmentCount;
+	Segment& segment = segments[segmentIndex];
+
+	SegmentIndexEntry& entry = entries[slot];
+	entry.simulationID = simulationID;
+	entry.segment = segmentIndex;
+	entry.length = trajectory.size();
+	entry.endTime = endTime;
+	entry.eventCount = eventCount;
+	entry.metrics = metrics;
+
+	lock_guard<mutex> guard(segment.lock);
+
+	// Binary trajectories start at a column boundary, so their columns stay aligned in a mapped segment (compressed
+	// ones have an extension after the type and are not mapped).
+	if (format == "bin") {
+		uint64_t aligned = BinaryTrajectory::alignColumn(segment.size);
+		string padding(aligned - segment.size, '\0');
+		segment.file.write(padding.data(), padding.size());
+		segment.size = aligned;
+	}
+
+	entry.offset = segment.size;
+	segment.file.write(trajectory.data(), trajectory.size());
+	segment.size += trajectory.size();
+}
+
+void SegmentedOutput::finish() {
+
+	if (finished) {
+		return;
+	}
+	finished = true;
+
+	for (int i = 0; i < segmentCount; i++) {
+		segments[i].file.close();
+	}
+
+	SegmentIndexHeader header;
+	memset(&header, 0, sizeof(header));
+
+	memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+	header.byteOrder = BYTE_ORDER_MARK;
+	header.entrySize = sizeof(SegmentIndexEntry);
+	header.firstID = firstID;
+	header.segmentCount = segmentCount;
+	header.entryCount = entries.size();
+	strncpy(header.format, format.c_str(), sizeof(header.format) - 1);
+
+	ofstream index(findIndexFilename(), ios::binary);
+	index.write((const char*)&header, sizeof(header));
+	index.write((const char*)entries.data(), entries.size() * sizeof(SegmentIndexEntry));
+	index.close();
+}
+
+bool SegmentedOutput::findEntry(int simulationID, SegmentIndexHeader& header, SegmentIndexEntry& entry) {
+
+	ifstream index(findIndexFilename(), ios::binary);
+
+	if (!index.read((char*)&header, sizeof(header)) || memcmp(header.magic, INDEX_MAGIC, sizeof(header.magic)) != 0 ||
+		header.byteOrder != BYTE_ORDER_MARK || header.entrySize != sizeof(SegmentIndexEntry)) {
+		return false;
+	}
+
+	if (simulationID < header.firstID || (uint64_t)(simulationID - header.firstID) >= header.entryCount) {
+		return false;
+	}
+
+	index.seekg(sizeof(header) + (uint64_t)(simulationID - header.firstID) * sizeof(SegmentIndexEntry));
+	return index.read((char*)&entry, sizeof(entry)) && entry.simulationID == simulationID;
+}
+
+bool SegmentedOutput::readTrajectory(int simulationID, string& trajectory) {
+
+	SegmentIndexHeader header;
+	SegmentIndexEntry entry;
+
+	if (!findEntry(simulationID, header, entry)) {
+		return false;
+	}
+
+	header.format[sizeof(header.format) - 1] = '\0';
+	ifstream segment(findSegmentFilename(entry.segment, header.format), ios::binary);
+
+	trajectory.resize(entry.length);
+	segment.seekg(entry.offset);
+	return (bool)segment.read(&trajectory[0], entry.length);
+}
@@ -0,0 +1,101 @@
+#ifndef _SEGMENTEDOUTPUT_H_
+
+#define _SEGMENTEDOUTPUT_H_
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <mutex>
+#include <memory>
+#include <cstdint>
+
+#include "TrajectoryMetrics.h"
+
+using namespace std;
+
+// Layout of the index of a consolidated output (output_files/output_index.idx): a SegmentIndexHeader followed by
+// one SegmentIndexEntry per simulation, in the order of the simulation IDs starting at firstID. The entry of a
+// simulation is therefore read with a single seek, and points at its trajectory in one of the segment files.
+struct SegmentIndexHeader {
+	char magic[8];
+	uint32_t byteOrder;
+	uint32_t entrySize;
+	int32_t firstID;
+	int32_t segmentCount;
+	uint64_t entryCount;
+	// The output type of the trajectories ("txt", "csv", "log" or "bin"), followed by the extension of their
+	// compression if they are compressed (eg. "csv.gz"). It is also the extension of the segment files.
+	char format[8];
+};
+
+struct SegmentIndexEntry {
+	int32_t simulationID;
+	int32_t segment;
+	// Position and size of the trajectory in its segment file. The trajectory is the content of the file the
+	// simulation writes without consolidation (a complete compressed stream when the output is compressed).
+	uint64_t offset;
+	uint64_t length;
+	// Summary of the simulation. The metrics of the simulations of the built-in types are the ones tracked while
+	// they run (all zero for the Network engine).
+	double endTime;
+	int64_t eventCount;
+	TrajectoryMetrics metrics;
+};
+
+static_assert(sizeof(SegmentIndexHeader) == 40, "The segment index header must not contain padding.");
+static_assert(sizeof(SegmentIndexEntry) == 88, "The segment index entries must not contain padding.");
+
+// Writes the trajectories of all simulations into a few segment files instead of one file each. The simulations
+// are spread over the segments by ID, and each segment is appended to under its own lock, so threads writing
+// to different segments do not wait for each other. finish writes the index.
+class SegmentedOutput {
+
+public:
+
+	static constexpr char INDEX_MAGIC[8] = { 'C', 'S', 'B', 'M', 'I', 'D', 'X', '2' };
+	static constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+	// Constructor. Creates the segment files for the simulations with IDs firstID to firstID + simulationCount - 1.
+	SegmentedOutput(int segmentCount, string outputFormat, int firstID, int simulationCount);
+	~SegmentedOutput() { finish(); }
+
+	SegmentedOutput(const SegmentedOutput&) = delete;
+	SegmentedOutput& operator=(const SegmentedOutput&) = delete;
+
+	// Appends the trajectory of a simulation to its segment. Safe to call from several threads.
+	void append(int simulationID, const string& trajectory, double endTime, long long eventCount, const TrajectoryMetrics& metrics);
+
+	// Closes the segments and writes the index.
+	void finish();
+
+	static const string findSegmentFilename(int segment, string format) {
+		return string("output_files/output_segment_") + to_string(segment) + "." + format;
+	}
+	static const string findIndexFilename() {
+		return "output_files/output_index.idx";
+	}
+
+	// Looks up a simulation in the index of a consolidated output and reads its trajectory. Returns false if there
+	// is no valid index or the simulation is not in it.
+	static bool findEntry(int simulationID, SegmentIndexHeader& header, SegmentIndexEntry& entry);
+	static bool readTrajectory(int simulationID, string& trajectory);
+
+private:
+
+	struct Segment {
+		ofstream file;
+		uint64_t size = 0;
+		mutex lock;
+	};
+
+	unique_ptr<Segment[]> segments;
+	int segmentCount;
+	string format;
+
+	int firstID;
+	vector<SegmentIndexEntry> entries;
+
+	bool finished = false;
+};
+
+#endif
@@ -4,28 +4,37 @@
 #include <omp.h>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <vector>
 #include <string>
 #include <chrono>
 #include <ctime>
 #include <limits>
+#include <cmath>
+#include <algorithm>
 #include <iomanip>
+#include <cstring>
 
-int SimulationInfo::IDGenerator = 0;
+#include "BinaryTrajectory.h"
+#include "NextReactionEngine.h"
+#include "TauLeapingEngine.h"
+#include "LangevinEngine.h"
+#include "MeanFieldEngine.h"
 
-SimulationInfo::SimulationInfo(Configuration& config) {
+SimulationInfo::SimulationInfo(Configuration& config) : SimulationInfo(config, TrajectoryStream::generateID()) {}
 
-	// Generate ID.
-	id = IDGenerator++;
+SimulationInfo::SimulationInfo(Configuration& config, int simulationID) : id(simulationID), trajectoryStream(config, simulationID) {
 
-	// Set simulation type.
+	// Set simulation type and engine.
 	this->simulationType = config.getType();
+	this->engine = config.getEngine();
 
-	std::mt19937_64 rng;
-	// initialize the random number generator with time-dependent seed
-	uint64_t timeSeed = std::chrono::high_resolution_clock::now().time_since_epoch().count();
-	std::seed_seq ss{ uint32_t(timeSeed & 0xffffffff), uint32_t(timeSeed >> 32) };
-	rng.seed(ss);
+	// Each simulation owns its own random stream, keyed by the master seed and identified by the simulation ID.
+	rng = RandomGenerator(config.getSeed(), id);
+
+	if (!config.getSamplingTimes().empty()) {
+		samplingTimes = &config.getSamplingTimes();
+	}
 
 	auto populations = config.getPopulationBoundaries();
 	// Initialise the populations.
@@ -48,6 +57,8 @@ SimulationInfo::SimulationInfo(Configuration& config) {
 	}
 	
 	totalPopulation = susceptible + exposed + infected + recovered;
+	initialPopulation = totalPopulation;
+	initialInfectious = exposed + infected;
 
 	auto parameters = config.getParameterBoundaries();
 	// Initialise the parameters.
@@ -77,203 +88,683 @@ SimulationInfo::SimulationInfo(Configuration& config) {
 	for (unsigned i = 0; i < events.size(); i++) {
 		if (events[i] != false) {
 			if (i == 0) {
-				eventList.push_back(Event("Vaccination"));
+				activeEventNames.push_back("Vaccination");
 				std::uniform_real_distribution<double> unif(config.getVaccinationTimestampBoundaries()[0], config.getVaccinationTimestampBoundaries()[1]);
-				vaccinationTimestamp = unif(rng);
+				double vaccinationTimestamp = unif(rng);
 				vaccinationEfficiency = config.getVaccinationEfficiency();
+
+				// A campaign repeats the vaccination at a fixed interval after the first one.
+				for (int k = 0; k < config.getVaccinationCount(); k++) {
+					scheduledInterventions.push(ScheduledIntervention(vaccinationTimestamp + k * config.getVaccinationInterval(), VACCINATION));
+				}
+				nextInterventionTime = scheduledInterventions.top().time;
 			}
 			else {
-				eventList.push_back(Event("Revaccination"));
+				activeEventNames.push_back("Revaccination");
 				revaccinationEfficiency = config.getRevaccinationEfficiency();
+				// Revaccination follows a vaccination, so it cannot occur without one.
+				revaccinationUsed = events[0] != false;
 			}
 		}
 	}
 
+	buildDependencyGraph();
+
+	metricThreshold = config.getMetricThreshold();
+
+	logRecording = config.getOutputFormat() == "log";
+	if (logRecording) {
+		trajectoryLog.setEventChanges(recordedEventChanges());
+	}
+
+	// Select the step function once; the direct method runs a kernel specialized for the simulation type.
+	switch (engine) {
+	case Configuration::SimulationEngine::DIRECT:
+		if (simulationType == Configuration::SimulationType::SIR) {
+			stepFunction = &SimulationInfo::specializedDirectStep<Configuration::SimulationType::SIR>;
+		}
+		else if (simulationType == Configuration::SimulationType::SEIR) {
+			stepFunction = &SimulationInfo::specializedDirectStep<Configuration::SimulationType::SEIR>;
+		}
+		else {
+			stepFunction = &SimulationInfo::specializedDirectStep<Configuration::SimulationType::SEIR_simplified>;
+		}
+		break;
+	case Configuration::SimulationEngine::NEXT_REACTION:
+		stepEngine.reset(new NextReactionEngine());
+		stepFunction = &SimulationInfo::engineStep;
+		break;
+	case Configuration::SimulationEngine::TAU_LEAPING:
+		stepEngine.reset(new TauLeapingEngine());
+		stepFunction = &SimulationInfo::engineStep;
+		break;
+	case Configuration::SimulationEngine::LANGEVIN:
+		stepEngine.reset(new LangevinEngine(config.getTimeStep()));
+		stepFunction = &SimulationInfo::engineStep;
+		break;
+	case Configuration::SimulationEngine::MEAN_FIELD:
+		stepEngine.reset(new MeanFieldEngine(config.getTimeStep()));
+		stepFunction = &SimulationInfo::engineStep;
+		break;
+	default:
+		stepFunction = &SimulationInfo::directStep;
+		break;
+	}
 }
 
-void SimulationInfo::updateProbabilities() {
-	
-	elementaryEventChances[BIRTH] = birthChance();
-	elementaryEventChances[DEATH_OF_SUSCEPTIBLE] = deathOfSusceptibleChance();
-	elementaryEventChances[SICKNESS] = sicknessChance();
-	elementaryEventChances[DEATH_OF_INFECTED] = deathOfInfectedChance();
-	elementaryEventChances[DEATH_OF_RECOVERED] = deathOfRecoveredChance();
-	elementaryEventChances[INFECTION] = infectionChance();
-	elementaryEventChances[DEATH_DUE_TO_INFECTION] = deathDueToInfectionChance();
-	elementaryEventChances[RECOVERY] = recoveryChance();
+vector<vector<int>> SimulationInfo::recordedEventChanges() {
+
+	vector<vector<int>> changes(ELEMENTARY_EVENT_COUNT, vector<int>(TrajectoryLog::FIELD_COUNT, 0));
+
+	// The populations change by the stoichiometry, the counters as in processOccurred.
+	for (int i = 0; i < ELEMENTARY_EVENT_COUNT; i++) {
+		for (int j = 0; j < COMPARTMENT_COUNT; j++) {
+			changes[i][j] = stoichiometry[i][j];
+		}
+	}
+
+	changes[BIRTH][TrajectoryLog::BIRTHS] = 1;
+	changes[DEATH_OF_SUSCEPTIBLE][TrajectoryLog::DEATHS_OF_SUSCEPTIBLE] = 1;
+	changes[DEATH_OF_INFECTED][TrajectoryLog::DEATHS_OF_INFECTED] = 1;
+	changes[DEATH_OF_RECOVERED][TrajectoryLog::DEATHS_OF_RECOVERED] = 1;
+	changes[DEATH_DUE_TO_INFECTION][TrajectoryLog::DEATHS_DUE_TO_INFECTION] = 1;
 
+	changes[DEATH_OF_SUSCEPTIBLE][TrajectoryLog::DEATHS_TOTAL] = 1;
+	changes[DEATH_OF_INFECTED][TrajectoryLog::DEATHS_TOTAL] = 1;
+	changes[DEATH_OF_RECOVERED][TrajectoryLog::DEATHS_TOTAL] = 1;
+	changes[DEATH_DUE_TO_INFECTION][TrajectoryLog::DEATHS_TOTAL] = 1;
+
+	return changes;
 }
 
-double SimulationInfo::getTimeOfNextEvent() {
-	double chancesTotal = 0;
+void SimulationInfo::buildDependencyGraph() {
+
+	// Compartments each elementary event chance is computed from.
+	const unsigned chanceInputs[ELEMENTARY_EVENT_COUNT] = {
+		1u << TOTAL,
+		1u << SUSCEPTIBLE,
+		1u << EXPOSED,
+		1u << INFECTED,
+		1u << RECOVERED,
+		(1u << SUSCEPTIBLE) | (1u << INFECTED) | (1u << TOTAL),
+		1u << INFECTED,
+		1u << INFECTED
+	};
+
 	for (int i = 0; i < ELEMENTARY_EVENT_COUNT; i++) {
-		chancesTotal += elementaryEventChances[i];
+		for (int j = 0; j < COMPARTMENT_COUNT; j++) {
+			stoichiometry[i][j] = 0;
+		}
 	}
 
-	// Get next time of event with an exponential random number generator.
-	std::default_random_engine generator;
-	std::exponential_distribution<double> distribution(chancesTotal);
+	stoichiometry[BIRTH][SUSCEPTIBLE] = 1;
+	stoichiometry[BIRTH][TOTAL] = 1;
+
+	stoichiometry[DEATH_OF_SUSCEPTIBLE][SUSCEPTIBLE] = -1;
+	stoichiometry[DEATH_OF_SUSCEPTIBLE][TOTAL] = -1;
+
+	stoichiometry[SICKNESS][EXPOSED] = -1;
+	stoichiometry[SICKNESS][INFECTED] = 1;
+
+	stoichiometry[DEATH_OF_INFECTED][INFECTED] = -1;
+	stoichiometry[DEATH_OF_INFECTED][TOTAL] = -1;
+
+	stoichiometry[DEATH_OF_RECOVERED][RECOVERED] = -1;
+	stoichiometry[DEATH_OF_RECOVERED][TOTAL] = -1;
+
+	stoichiometry[INFECTION][SUSCEPTIBLE] = -1;
+	stoichiometry[INFECTION][simulationType == Configuration::SimulationType::SIR ? INFECTED : EXPOSED] = 1;
 
-	return distribution(generator);
+	stoichiometry[DEATH_DUE_TO_INFECTION][INFECTED] = -1;
+	stoichiometry[DEATH_DUE_TO_INFECTION][TOTAL] = -1;
+
+	stoichiometry[RECOVERY][INFECTED] = -1;
+	stoichiometry[RECOVERY][RECOVERED] = 1;
+
+	// Events are searched in enumeration order until the optimized direct method reorders them.
+	for (int i = 0; i < ELEMENTARY_EVENT_COUNT; i++) {
+		searchOrder[i] = i;
+		firingCounts[i] = 0;
+	}
+
+	// An event depends on another if it reads a compartment the other one changes.
+	for (int i = 0; i < ELEMENTARY_EVENT_COUNT; i++) {
+		unsigned changed = 0;
+		for (int j = 0; j < COMPARTMENT_COUNT; j++) {
+			if (stoichiometry[i][j] != 0) {
+				changed |= 1u << j;
+			}
+		}
+
+		dependentEventCount[i] = 0;
+		for (int k = 0; k < ELEMENTARY_EVENT_COUNT; k++) {
+			if ((chanceInputs[k] & changed) != 0) {
+				dependentEvents[i][dependentEventCount[i]++] = k;
+			}
+		}
+	}
 }
 
-void SimulationInfo::selectProcess() {
-	double chancesTotal = 0;
+const string SimulationInfo::getElementaryEventName(int elementaryEvent) {
+	switch (elementaryEvent) {
+	case BIRTH: return "Birth";
+	case DEATH_OF_SUSCEPTIBLE: return "Death of susceptible";
+	case SICKNESS: return "Sickness";
+	case DEATH_OF_INFECTED: return "Death of infected";
+	case DEATH_OF_RECOVERED: return "Death of recovered";
+	case INFECTION: return "Infection";
+	case DEATH_DUE_TO_INFECTION: return "Death due to infection";
+	default: return "Recovery";
+	}
+}
+
+void SimulationInfo::updateProbabilities() {
+
+	// The incremental engines only recompute the chances affected by the last elementary event.
+	if (engine != Configuration::SimulationEngine::DIRECT && !chancesStale) {
+		updateDependentProbabilities();
+		return;
+	}
+	
+	for (int i = 0; i < ELEMENTARY_EVENT_COUNT; i++) {
+		elementaryEventChances[i] = elementaryEventChance(i);
+	}
+
+	chancesTotal = 0;
 	for (int i = 0; i < ELEMENTARY_EVENT_COUNT; i++) {
 		chancesTotal += elementaryEventChances[i];
 	}
 
-	// Grab a random number between 0 and 1.
-	std::mt19937_64 rng;
-	uint64_t timeSeed = std::chrono::high_resolution_clock::now().time_since_epoch().count();
-	std::seed_seq ss{ uint32_t(timeSeed & 0xffffffff), uint32_t(timeSeed >> 32) };
-	rng.seed(ss);
-	std::uniform_real_distribution<double> unif(0, 1);
+	lastEvent = NO_EVENT;
+	chancesStale = false;
+	stepsSinceResummation = 0;
+}
+
+void SimulationInfo::updateDependentProbabilities() {
+
+	if (lastEvent == NO_EVENT) {
+		return;
+	}
+
+	for (int i = 0; i < dependentEventCount[lastEvent]; i++) {
+		int dependentEvent = dependentEvents[lastEvent][i];
+		double chance = elementaryEventChance(dependentEvent);
+
+		chancesTotal += chance - elementaryEventChances[dependentEvent];
+		elementaryEventChances[dependentEvent] = chance;
+	}
+
+	lastEvent = NO_EVENT;
+
+	if (++stepsSinceResummation == RESUMMATION_INTERVAL) {
+		chancesTotal = 0;
+		for (int i = 0; i < ELEMENTARY_EVENT_COUNT; i++) {
+			chancesTotal += elementaryEventChances[i];
+		}
+		stepsSinceResummation = 0;
+	}
+}
+
+void SimulationInfo::useGenericKernel() {
+	if (engine == Configuration::SimulationEngine::DIRECT) {
+		stepFunction = &SimulationInfo::directStep;
+	}
+}
 
-	double rand = unif(rng);
+template <Configuration::SimulationType TYPE>
+double SimulationInfo::specializedDirectStep(double currentTime) {
+
+	// Only the elementary events possible in this simulation type are evaluated and searched.
+	constexpr const int* liveEvents = TYPE == Configuration::SimulationType::SIR ? SIR_EVENTS :
+		TYPE == Configuration::SimulationType::SEIR ? SEIR_EVENTS : SEIR_SIMPLIFIED_EVENTS;
+	constexpr int liveEventCount = TYPE == Configuration::SimulationType::SIR ? sizeof(SIR_EVENTS) / sizeof(int) :
+		TYPE == Configuration::SimulationType::SEIR ? sizeof(SEIR_EVENTS) / sizeof(int) : sizeof(SEIR_SIMPLIFIED_EVENTS) / sizeof(int);
+
+	chancesTotal = 0;
+	for (int k = 0; k < liveEventCount; k++) {
+		double chance = elementaryEventChance<TYPE>(liveEvents[k], susceptible, exposed, infected, recovered, totalPopulation);
+		elementaryEventChances[liveEvents[k]] = chance;
+		chancesTotal += chance;
+	}
+
+	double nextTime = currentTime + variates->nextUnitExponential() / chancesTotal;
+	double target = variates->nextUniform() * chancesTotal;
+
+	// An intervention before the next elementary event changes the chances; the step ends at the intervention,
+	// and the waiting time is drawn again from there (the process is memoryless).
+	if (nextTime > nextInterventionTime) {
+		return applyScheduledInterventions();
+	}
+
+	int selectedEvent = NO_EVENT;
+	int selectedPosition = 0;
 
 	double linePointer = 0;
-	for (int i = 0; i < ELEMENTARY_EVENT_COUNT; i++) {
-		linePointer += elementaryEventChances[i] / chancesTotal;
-		if (rand <= linePointer) {
-			// i-th elementary event has occured.
-			if (elementaryEventChances[i] != 0) {
-				processOccurred((ElementaryEvent)i);
+	for (int k = 0; k < liveEventCount; k++) {
+		double chance = elementaryEventChances[liveEvents[k]];
+		if (chance != 0) {
+			linePointer += chance;
+			selectedEvent = liveEvents[k];
+			selectedPosition = k;
+
+			if (target < linePointer) {
+				break;
+			}
+		}
+	}
+
+	if (selectedEvent != NO_EVENT) {
+		searchDepth += selectedPosition + 1;
+		processOccurred<TYPE>((ElementaryEvent)selectedEvent, 1);
+	}
+
+	return nextTime;
+}
+
+double SimulationInfo::directStep(double currentTime) {
+
+	updateProbabilities();
+	double nextTime = currentTime + getTimeOfNextEvent();
+
+	if (nextTime > nextInterventionTime) {
+		// The uniform of the step is still drawn, so all direct method engines consume the same variates.
+		variates->nextUniform();
+		return applyScheduledInterventions();
+	}
+
+	selectProcess();
+
+	return nextTime;
+}
+
+void SimulationInfo::attachVariateBuffer(VariateBuffer& buffer) {
+	// Must be called before the first step of the direct method engines, on the thread running the simulation.
+	variates = &buffer;
+	buffer.attach(rng);
+}
+
+double SimulationInfo::getTimeOfNextEvent() {
+	// Get next time of event with an exponential random number generator.
+	return variates->nextUnitExponential() / chancesTotal;
+}
+
+void SimulationInfo::selectProcess() {
+	// Grab a random point on the line of all chances.
+	double target = variates->nextUniform() * chancesTotal;
+
+	int selectedEvent = NO_EVENT;
+	int selectedPosition = 0;
+
+	double linePointer = 0;
+	for (int position = 0; position < ELEMENTARY_EVENT_COUNT; position++) {
+		int i = searchOrder[position];
+		if (elementaryEventChances[i] != 0) {
+			linePointer += elementaryEventChances[i];
+			selectedEvent = i;
+			selectedPosition = position;
+
+			if (target < linePointer) {
+				// i-th elementary event has occured.
 				break;
 			}
-			
 		}
 	}
+
+	if (selectedEvent == NO_EVENT) {
+		return;
+	}
+
+	searchDepth += selectedPosition + 1;
+	processOccurred((ElementaryEvent)selectedEvent);
+
+	// The optimized direct method keeps the most frequent events at the front of the search order.
+	if (engine == Configuration::SimulationEngine::OPTIMIZED_DIRECT) {
+		while (selectedPosition > 0 && firingCounts[selectedEvent] > firingCounts[searchOrder[selectedPosition - 1]]) {
+			searchOrder[selectedPosition] = searchOrder[selectedPosition - 1];
+			searchOrder[selectedPosition - 1] = selectedEvent;
+			selectedPosition--;
+		}
+	}
+}
+
+void SimulationInfo::processOccurred(ElementaryEvent elementaryEvent, int count) {
+	switch (simulationType) {
+	case Configuration::SimulationType::SIR:
+		processOccurred<Configuration::SimulationType::SIR>(elementaryEvent, count);
+		break;
+	case Configuration::SimulationType::SEIR:
+		processOccurred<Configuration::SimulationType::SEIR>(elementaryEvent, count);
+		break;
+	default:
+		processOccurred<Configuration::SimulationType::SEIR_simplified>(elementaryEvent, count);
+		break;
+	}
 }
 
-void SimulationInfo::processOccurred(ElementaryEvent elementaryEvent) {
+template <Configuration::SimulationType TYPE>
+void SimulationInfo::processOccurred(ElementaryEvent elementaryEvent, int count) {
+
+	lastEvent = elementaryEvent;
+	firingCounts[elementaryEvent] += count;
 	
 	switch (elementaryEvent) {
 
 	case BIRTH:
-		susceptible++;
-		totalPopulation++;
+		susceptible += count;
+		totalPopulation += count;
 
-		births++;
+		births += count;
 		break;
 	case DEATH_OF_SUSCEPTIBLE:
-		susceptible--;
-		totalPopulation--;
+		susceptible -= count;
+		totalPopulation -= count;
 
-		diedS++;
-		deathsTotal++;
+		diedS += count;
+		deathsTotal += count;
 		break;
 	case SICKNESS:
-		exposed--;
-		infected++;
+		exposed -= count;
+		infected += count;
 		break;
 	case DEATH_OF_INFECTED:
-		infected--;
-		totalPopulation--;
+		infected -= count;
+		totalPopulation -= count;
 
-		diedI++;
-		deathsTotal++;
+		diedI += count;
+		deathsTotal += count;
 		break;
 	case DEATH_OF_RECOVERED:
-		recovered--;
-		totalPopulation--;
+		recovered -= count;
+		totalPopulation -= count;
 
-		diedR++;
-		deathsTotal++;
+		diedR += count;
+		deathsTotal += count;
 		break;
 	case INFECTION:
-		susceptible--;
-		if (simulationType == Configuration::SimulationType::SIR) {
-			infected++;
+		susceptible -= count;
+		if constexpr (TYPE == Configuration::SimulationType::SIR) {
+			infected += count;
 		}
 		else {
-			exposed++;
+			exposed += count;
 		}
 		break;
 	case DEATH_DUE_TO_INFECTION:
-		infected--;
-		totalPopulation--;
+		infected -= count;
+		totalPopulation -= count;
 
-		diedDueToI++;
-		deathsTotal++;
+		diedDueToI += count;
+		deathsTotal += count;
 		break;
 	case RECOVERY:
-		infected--;
-		recovered++;
+		infected -= count;
+		recovered += count;
 
 		break;
 	}
 }
 
-void SimulationInfo::checkEvents(double time) {
-	for (unsigned i = 0; i < eventList.size(); i++) {
-		if (eventList[i].occurred == false) {
-			if (eventList[i].eventName == "Vaccination") {
-				// Check vaccination condition.
-				if (time >= vaccinationTimestamp) {
+double SimulationInfo::applyScheduledInterventions() {
 
-					int curedByVaccination = (int)(vaccinationEfficiency * susceptible);
-					susceptible -= curedByVaccination;
-					recovered += curedByVaccination;
+	// Interventions falling on the same time are applied together.
+	double time = nextInterventionTime;
+	while (!scheduledInterventions.empty() && scheduledInterventions.top().time <= time) {
+		Intervention intervention = (Intervention)scheduledInterventions.top().intervention;
+		scheduledInterventions.pop();
+		applyIntervention(intervention);
+	}
 
-					eventList[i].occurred = true;
-				}
-			}
-			else {
-				// Check revaccination condition.
-				if (i == 0) {
-					// No vaccination beforehand. This event's conditions can never be met.
-					return;
-				}
+	nextInterventionTime = scheduledInterventions.empty() ? numeric_limits<double>::infinity() : scheduledInterventions.top().time;
+	return time;
+}
 
-				if (eventList[0].occurred == true && infected > 0.3 * totalPopulation) {
-					int curedByRevaccination = (int)(revaccinationEfficiency * susceptible);
+void SimulationInfo::applyIntervention(Intervention intervention) {
 
-					susceptible -= curedByRevaccination;
-					recovered += curedByRevaccination;
+	appliedInterventions |= 1u << intervention;
 
-					eventList[i].occurred = true;
-				}
+	double efficiency = intervention == VACCINATION ? vaccinationEfficiency : revaccinationEfficiency;
+	int curedByVaccination = (int)(efficiency * susceptible);
 
-			}
-		}
+	susceptible -= curedByVaccination;
+	recovered += curedByVaccination;
+	chancesStale = true;
+
+	if (intervention == VACCINATION && revaccinationUsed) {
+		// The first vaccination arms the revaccination, which may then be triggered right away.
+		revaccinationUsed = false;
+		revaccinationArmed = true;
+		checkEvents();
 	}
 }
 
-const void SimulationInfo::outputToFile(string format) {
+void SimulationInfo::checkRevaccination() {
+	if (infected > 0.3 * totalPopulation) {
+		revaccinationArmed = false;
+		applyIntervention(REVACCINATION);
+	}
+}
 
-	if (format == "txt") {
-		outputTXT();
+const void SimulationInfo::outputToFile(string format, SegmentedOutput* segments) {
+
+	if (format != "txt" && format != "csv" && format != "log" && format != "bin") {
+		return;
 	}
-	else if (format == "csv") {
-		outputCSV();
+
+	// A streamed simulation already wrote its header and all but the last chunk of its records.
+	if (trajectoryStream.isStreaming()) {
+		flushRecords();
+		outputFooter(trajectoryStream.getStream(), format, firstData, lastData);
+		trajectoryStream.finish();
+
+		// Release the chunk, so a finished simulation only keeps its summary.
+		releaseRecords();
+		return;
 	}
-	
+
+	long long eventCount = 0;
+	for (int i = 0; i < ELEMENTARY_EVENT_COUNT; i++) {
+		eventCount += firingCounts[i];
+	}
+
+	trajectoryStream.write(format, segments, endTime, eventCount, getMetrics(), [this, &format](ostream& stream) {
+		outputTrajectory(stream, format);
+	});
+}
+
+const void SimulationInfo::outputTrajectory(ostream& cout, string format) {
+
+	if (format == "bin") {
+		outputBinary(cout);
+		return;
+	}
+
+	if (format == "log") {
+		trajectoryLog.writeHeader(cout, id, simulationType);
+		trajectoryLog.writeRecords(cout);
+		return;
+	}
+
+	outputHeader(cout, format, simulationData[0]);
+	outputRecords(cout, format);
+	outputFooter(cout, format, simulationData[0], simulationData[simulationData.size() - 1]);
 }
 
-const void SimulationInfo::outputTXT() {
+void SimulationInfo::startStreaming(OutputStream& stream, string format) {
 
-	// Calculate filename.
-	string filename = findFilename("txt");
+	if (format != "txt" && format != "csv" && format != "log") {
+		return;
+	}
 
-	ofstream cout;
+	trajectoryStream.start(stream, format);
+	recordsWritten = 0;
 
-	cout.open(filename);
+	if (format == "log") {
+		trajectoryLog.writeHeader(stream, id, simulationType);
+		return;
+	}
+
+	// The iterations are saved from here on, so the initial populations are the current ones.
+	outputHeader(stream, format, RecordedData(0, susceptible, exposed, infected, recovered, totalPopulation,
+		births, diedS, diedI, diedR, diedDueToI, deathsTotal));
+
+	simulationData.reserve(TrajectoryStream::CHUNK_SIZE);
+}
+
+void SimulationInfo::flushRecords() {
+
+	if (logRecording) {
+		trajectoryLog.writeRecords(trajectoryStream.getStream());
+		return;
+	}
+
+	if (simulationData.empty()) {
+		return;
+	}
+
+	if (recordsWritten == 0) {
+		firstData = simulationData[0];
+	}
+	lastData = simulationData[simulationData.size() - 1];
+
+	outputRecords(trajectoryStream.getStream(), trajectoryStream.getFormat());
+	recordsWritten += simulationData.size();
+
+	// Clearing keeps the capacity, so the chunk is reused for the next records.
+	simulationData.clear();
+}
+
+const SimulationInfo::Summary SimulationInfo::getSummary() {
+	Summary summary;
+
+	summary.endTime = endTime;
+	summary.mortalityRate = mortalityRate;
+	summary.infectedMortalityRate = infectedMortalityRate;
+	summary.recoveryRate = recoveryRate;
+	summary.incubationPeriod = incubationPeriod;
+	summary.infectionRate = infectionRate;
+	summary.metrics = getMetrics();
+
+	return summary;
+}
+
+const TrajectoryMetrics SimulationInfo::getMetrics() {
+	TrajectoryMetrics metrics;
+
+	metrics.peakTime = peakTime;
+	metrics.peakInfected = peakInfected;
+	metrics.finalSize = initialInfectious + (int)firingCounts[INFECTION];
+	metrics.population = initialPopulation + births;
+	metrics.deathsSusceptible = diedS;
+	metrics.deathsInfected = diedI;
+	metrics.deathsRecovered = diedR;
+	metrics.deathsDueToInfection = diedDueToI;
+	metrics.reserved = 0;
+	metrics.timeAboveThreshold = timeAboveThreshold;
+
+	return metrics;
+}
+
+const void SimulationInfo::outputBinary(ostream& cout) {
+
+	uint64_t recordCount = simulationData.size();
+
+	BinaryTrajectoryHeader header;
+	memset(&header, 0, sizeof(header));
+
+	memcpy(header.magic, BinaryTrajectory::MAGIC, sizeof(header.magic));
+	header.byteOrder = BinaryTrajectory::BYTE_ORDER_MARK;
+	header.headerSize = sizeof(BinaryTrajectoryHeader);
+	header.simulationID = id;
+	header.simulationType = simulationType;
+	header.columnCount = BinaryTrajectory::COLUMN_COUNT;
+	header.recordCount = recordCount;
+
+	for (unsigned i = 0; i < activeEventNames.size(); i++) {
+		header.activeEvents |= activeEventNames[i] == "Vaccination" ? BinaryTrajectory::VACCINATION : BinaryTrajectory::REVACCINATION;
+	}
+
+	header.parameters[BinaryTrajectory::MORTALITY_RATE] = mortalityRate;
+	header.parameters[BinaryTrajectory::INFECTED_MORTALITY_RATE] = infectedMortalityRate;
+	header.parameters[BinaryTrajectory::RECOVERY_RATE] = recoveryRate;
+	header.parameters[BinaryTrajectory::INCUBATION_PERIOD] = incubationPeriod;
+	header.parameters[BinaryTrajectory::INFECTION_RATE] = infectionRate;
+
+	uint64_t offset = BinaryTrajectory::alignColumn(sizeof(BinaryTrajectoryHeader));
+	for (int i = 0; i < BinaryTrajectory::COLUMN_COUNT; i++) {
+		header.columnOffsets[i] = offset;
+		offset = BinaryTrajectory::alignColumn(offset + recordCount * BinaryTrajectory::columnElementSize(i));
+	}
+
+	// Integer fields in the order of the columns after the timestamps.
+	int RecordedData::* const INTEGER_FIELDS[BinaryTrajectory::COLUMN_COUNT - 1] = {
+		&RecordedData::susceptible, &RecordedData::exposed, &RecordedData::infected, &RecordedData::recovered,
+		&RecordedData::total, &RecordedData::births, &RecordedData::deathsSuspectible, &RecordedData::deathsInfected,
+		&RecordedData::deathsRecovered, &RecordedData::deathsDueToInfection, &RecordedData::deathsTotal
+	};
+
+	// One write for the header and one per column, each padded up to where the next one starts. The values are
+	// written in the byte order of the host (little-endian on all supported platforms).
+	vector<char> buffer(header.columnOffsets[0], 0);
+	memcpy(buffer.data(), &header, sizeof(header));
+	cout.write(buffer.data(), buffer.size());
+
+	for (int i = 0; i < BinaryTrajectory::COLUMN_COUNT; i++) {
+		uint64_t end = i + 1 < BinaryTrajectory::COLUMN_COUNT ? header.columnOffsets[i + 1] : offset;
+		buffer.assign(end - header.columnOffsets[i], 0);
+
+		char* destination = buffer.data();
+		if (i == BinaryTrajectory::TIMESTAMP) {
+			for (const RecordedData& data : simulationData) {
+				memcpy(destination, &data.timestamp, sizeof(double));
+				destination += sizeof(double);
+			}
+		}
+		else {
+			int RecordedData::* field = INTEGER_FIELDS[i - 1];
+			for (const RecordedData& data : simulationData) {
+				int32_t value = data.*field;
+				memcpy(destination, &value, sizeof(int32_t));
+				destination += sizeof(int32_t);
+			}
+		}
+
+		cout.write(buffer.data(), buffer.size());
+	}
+}
+
+const void SimulationInfo::outputHeader(ostream& cout, string format, const RecordedData& initialData) {
+
+	if (format == "csv") {
+		cout << "Time,Susceptible";
+		if (simulationType != Configuration::SimulationType::SIR) {
+			cout << ",Exposed";
+		}
+		cout << ",Infected,Recovered,Total Population";
+		if (simulationType != Configuration::SimulationType::SEIR_simplified) {
+			cout << ",Births,Deaths - Susceptible, Deaths - Infected, Deaths - Recovered, Deaths - Due to Infection, Deaths - Total" << endl;
+		}
+		else {
+			cout << endl;
+		}
+
+		cout.fill(' ');
+		return;
+	}
 
 	cout << "Simulation ID-" << id << endl << "===================" << endl << endl;
 
 	cout << "1) General info " << endl << "-------------------" << endl;
 	cout << "Simulation type: " << (simulationType == Configuration::SimulationType::SIR ?
 		"SIR" : simulationType == Configuration::SimulationType::SEIR ? "SEIR" : "SEIR_simplified") << endl;
-	cout << "Thread ID: " << omp_get_thread_num() << endl << endl;
+	cout << "Thread ID: " << threadID << endl << endl;
 
 	cout << "2) Initial populations " << endl << "-------------------" << endl;
-	cout << "Susceptible: " << simulationData[0].susceptible << endl;
+	cout << "Susceptible: " << initialData.susceptible << endl;
 	if (simulationType != Configuration::SimulationType::SIR) {
-		cout << "Exposed: " << simulationData[0].exposed << endl;
+		cout << "Exposed: " << initialData.exposed << endl;
 	}
-	cout << "Infected: " << simulationData[0].infected << endl;
-	cout << "Recovered: " << simulationData[0].recovered << endl << endl;
+	cout << "Infected: " << initialData.infected << endl;
+	cout << "Recovered: " << initialData.recovered << endl << endl;
 
 	cout << "3) Initial parameters " << endl << "-------------------" << endl;
 	cout << "Mortality rate (m): " << mortalityRate << endl;
@@ -283,8 +774,8 @@ const void SimulationInfo::outputTXT() {
 	cout << "Infection rate (b): " << infectionRate << endl << endl;
 
 	cout << "4) Active events " << endl << "-------------------" << endl;
-	for (unsigned i = 0; i < eventList.size(); i++) {
-		cout << eventList[i].eventName << endl;
+	for (unsigned i = 0; i < activeEventNames.size(); i++) {
+		cout << activeEventNames[i] << endl;
 	}
 
 	cout << endl;
@@ -305,8 +796,57 @@ const void SimulationInfo::outputTXT() {
 	}
 
 	cout.fill(' ');
-	for (RecordedData data : simulationData) {
-		printData(simulationType, data, cout);
+}
+
+const void SimulationInfo::outputRecords(ostream& cout, string format) {
+
+	RecordFormatter formatter(cout);
+
+	if (format == "txt") {
+		for (const RecordedData& data : simulationData) {
+			printData(data, formatter);
+		}
+		return;
+	}
+
+	for (const RecordedData& data : simulationData) {
+		formatter.append(data.timestamp);
+		formatter.append(',');
+		formatter.append(data.susceptible);
+		formatter.append(',');
+		if (simulationType != Configuration::SimulationType::SIR) {
+			formatter.append(data.exposed);
+			formatter.append(',');
+		}
+		formatter.append(data.infected);
+		formatter.append(',');
+		formatter.append(data.recovered);
+		formatter.append(',');
+		formatter.append(data.total);
+
+		if (simulationType != Configuration::SimulationType::SEIR_simplified) {
+			formatter.append(',');
+			formatter.append(data.births);
+			formatter.append(',');
+			formatter.append(data.deathsSuspectible);
+			formatter.append(',');
+			formatter.append(data.deathsInfected);
+			formatter.append(',');
+			formatter.append(data.deathsRecovered);
+			formatter.append(',');
+			formatter.append(data.deathsDueToInfection);
+			formatter.append(',');
+			formatter.append(data.deathsTotal);
+		}
+		formatter.append('\n');
+	}
+}
+
+const void SimulationInfo::outputFooter(ostream& cout, string format, const RecordedData& firstRecord, const RecordedData& lastRecord) {
+
+	// Only the TXT report ends with a preview of the first and last records.
+	if (format != "txt") {
+		return;
 	}
 
 	cout << endl << "6) Simulation preview " << endl << "-------------------" << endl << endl;
@@ -323,84 +863,94 @@ const void SimulationInfo::outputTXT() {
 		cout << endl;
 	}
 
-	printData(simulationType, simulationData[0], cout);
-	printData(simulationType, simulationData[simulationData.size() - 1], cout);
-
-	cout.close();
+	RecordFormatter formatter(cout);
+	printData(firstRecord, formatter);
+	printData(lastRecord, formatter);
 }
 
-const void SimulationInfo::outputCSV() {
-	
-	string filename = findFilename("csv");
-
-	ofstream cout;
+void SimulationInfo::saveIteration(double currentTime) {
+	trackIteration(currentTime);
 
-	cout.open(filename);
+	RecordedData data(currentTime, susceptible, exposed, infected, recovered, totalPopulation, births, diedS, diedI, diedR, diedDueToI, deathsTotal);
 
-	cout << "Time,Susceptible";
-	if (simulationType != Configuration::SimulationType::SIR) {
-		cout << ",Exposed";
-	}
-	cout << ",Infected,Recovered,Total Population";
-	if (simulationType != Configuration::SimulationType::SEIR_simplified) {
-		cout << ",Births,Deaths - Susceptible, Deaths - Infected, Deaths - Recovered, Deaths - Due to Infection, Deaths - Total" << endl;
+	if (samplingTimes == nullptr) {
+		recordData(data);
+		return;
 	}
-	else {
-		cout << endl;
+
+	// The populations are piecewise constant: the previous state held at every grid point passed since the last step.
+	while (nextSample < samplingTimes->size() && (*samplingTimes)[nextSample] < currentTime) {
+		heldData.timestamp = (*samplingTimes)[nextSample++];
+		recordData(heldData);
 	}
+	heldData = data;
+}
 
-	cout.fill(' ');
+void SimulationInfo::trackEnsemble(double currentTime) {
 
-	for (RecordedData data : simulationData) {
-		cout << data.timestamp << ",";
-		cout << data.susceptible << ",";
-		if (simulationType != Configuration::SimulationType::SIR) {
-			cout << data.exposed << ",";
-		}
-		cout << data.infected << ",";
-		cout << data.recovered << ",";
-
-		if (simulationType != Configuration::SimulationType::SEIR_simplified) {
-			cout << data.total << ",";
-			cout << data.births << ",";
-			cout << data.deathsSuspectible << ",";
-			cout << data.deathsInfected << ",";
-			cout << data.deathsRecovered << ",";
-			cout << data.deathsDueToInfection << ",";
-			cout << data.deathsTotal << endl;
-		}
-		else {
-			cout << data.total << endl;
-		}
-		
+	// As on the recorded grid, the state held since the last step is the state at every grid point passed.
+	while (nextEnsemblePoint < ensemble->getGridSize() && ensemble->getGridTime(nextEnsemblePoint) < currentTime) {
+		ensemble->add(nextEnsemblePoint++, ensembleState);
 	}
 
-	cout.close();
+	ensembleState[0] = susceptible;
+	ensembleState[1] = exposed;
+	ensembleState[2] = infected;
+	ensembleState[3] = recovered;
+}
 
+void SimulationInfo::finishEnsemble() {
+	if (ensemble == nullptr) {
+		return;
+	}
+	while (nextEnsemblePoint < ensemble->getGridSize()) {
+		ensemble->add(nextEnsemblePoint++, ensembleState);
+	}
 }
-void SimulationInfo::saveIteration(double currentTime) {
-	simulationData.push_back(RecordedData(currentTime, susceptible, exposed, infected, recovered, totalPopulation, births, diedS, diedI, diedR, diedDueToI, deathsTotal));
+
+void SimulationInfo::finishRecording() {
+
+	// The final state is carried to the rest of the grid, so every simulation is recorded on the same time points.
+	if (samplingTimes == nullptr) {
+		return;
+	}
+	while (nextSample < samplingTimes->size()) {
+		heldData.timestamp = (*samplingTimes)[nextSample++];
+		recordData(heldData);
+	}
 }
 
-void SimulationInfo::printData(Configuration::SimulationType simulationType, RecordedData data, ofstream& cout) {
-	cout << "|" << fixed << setw(7) << left << setprecision(3) << data.timestamp << "|";
-	cout << setw(13) << left << data.susceptible << "|";
+void SimulationInfo::printData(const RecordedData& data, RecordFormatter& formatter) {
+	formatter.append('|');
+	formatter.appendFixedPadded(data.timestamp, 3, 7);
+	formatter.append('|');
+	formatter.appendPadded(data.susceptible, 13);
+	formatter.append('|');
 	if (simulationType != Configuration::SimulationType::SIR) {
-		cout << setw(9) << left << data.exposed << "|";
+		formatter.appendPadded(data.exposed, 9);
+		formatter.append('|');
 	}
-	cout << setw(10) << left << data.infected << "|";
-	cout << setw(11) << left << data.recovered << "|";
+	formatter.appendPadded(data.infected, 10);
+	formatter.append('|');
+	formatter.appendPadded(data.recovered, 11);
+	formatter.append('|');
+	formatter.appendPadded(data.total, 18);
+	formatter.append('|');
 
 	if (simulationType != Configuration::SimulationType::SEIR_simplified) {
-		cout << setw(18) << left << data.total << "| ||| |";
-		cout << setw(8) << left << data.births << "|";
-		cout << setw(22) << left << data.deathsSuspectible << "|";
-		cout << setw(19) << left << data.deathsInfected << "|";
-		cout << setw(20) << left << data.deathsRecovered << "|";
-		cout << setw(27) << left << data.deathsDueToInfection << "|";
-		cout << setw(16) << left << data.deathsTotal << "|" << endl;
-	}
-	else {
-		cout << setw(18) << left << data.total << "|" << endl;
+		formatter.append(" ||| |");
+		formatter.appendPadded(data.births, 8);
+		formatter.append('|');
+		formatter.appendPadded(data.deathsSuspectible, 22);
+		formatter.append('|');
+		formatter.appendPadded(data.deathsInfected, 19);
+		formatter.append('|');
+		formatter.appendPadded(data.deathsRecovered, 20);
+		formatter.append('|');
+		formatter.appendPadded(data.deathsDueToInfection, 27);
+		formatter.append('|');
+		formatter.appendPadded(data.deathsTotal, 16);
+		formatter.append('|');
 	}
+	formatter.append('\n');
 }
\ No newline at end of file
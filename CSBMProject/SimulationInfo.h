@@ -4,44 +4,54 @@
 
 #include <vector>
 #include <string>
+#include <queue>
+#include <functional>
+#include <limits>
+#include <fstream>
+#include <memory>
 
 #include "Configuration.h"
+#include "RecordedData.h"
+#include "TrajectoryLog.h"
+#include "SegmentedOutput.h"
+#include "TrajectoryMetrics.h"
+#include "EnsembleStatistics.h"
+#include "OutputStream.h"
+#include "TrajectoryStream.h"
+#include "RecordFormatter.h"
+#include "RandomGenerator.h"
+#include "VariateBuffer.h"
+#include "StepEngine.h"
 
 using namespace std;
 
-// A helper structure for holding data of each simulation stage.
-struct RecordedData {
-	double timestamp;
-	int susceptible;
-	int exposed;
-	int infected;
-	int recovered;
-	int total;
-	int births;
-	int deathsSuspectible;
-	int deathsInfected;
-	int deathsRecovered;
-	int deathsDueToInfection;
-	int deathsTotal;
-
-	RecordedData(double time, int S, int E, int I, int R, int N, int born, int diedS, int diedI, int diedR, int diedToInf, int diedTotal) :
-	timestamp(time), susceptible(S), exposed(E), infected(I), recovered(R), total(N), births(born), deathsSuspectible(diedS),
-	deathsInfected(diedI), deathsRecovered(diedR), deathsDueToInfection(diedToInf), deathsTotal(diedTotal) {}
-};
-
-// A helper structure for tracking events present in a simulation.
-struct Event {
-	bool occurred = false;
-	string eventName;
-	Event(string name) : eventName(name) {}
+// A helper structure for an intervention scheduled at a fixed time.
+struct ScheduledIntervention {
+	double time;
+	int intervention;
+	ScheduledIntervention(double t, int type) : time(t), intervention(type) {}
+	bool operator>(const ScheduledIntervention& other) const { return time > other.time; }
 };
 
 class SimulationInfo {
 
+	// The batch simulator runs the direct method on the state of several simulations at once, and the step
+	// engines run the other methods on the state of one.
+	friend class BatchSimulator;
+	friend class NextReactionEngine;
+	friend class TauLeapingEngine;
+	friend class ContinuousEngine;
+	friend class LangevinEngine;
+	friend class MeanFieldEngine;
+
 public:
 
-	// Constructor.
+	// Fields of a finished simulation needed by the aggregated output.
+	struct Summary;
+
+	// Constructors. Without an ID, the next one is generated.
 	SimulationInfo(Configuration& config);
+	SimulationInfo(Configuration& config, int simulationID);
 
 	// Getters methods.
 	const int getTotalPopulation() { return totalPopulation; }
@@ -52,7 +62,9 @@ public:
 
 	const int getInfectousCount() { return infected + exposed; }
 
-	const vector<RecordedData> getSimulationData() { return simulationData; }
+	const vector<RecordedData>& getSimulationData() { return simulationData; }
+	const double getEndTime() { return endTime; }
+	const TrajectoryMetrics getMetrics();
 
 	const double getMortalityRate() { return mortalityRate; }
 	const double getInfectedMortalityRate() { return infectedMortalityRate; }
@@ -60,23 +72,81 @@ public:
 	const double getIncubationPeriod() { return incubationPeriod; }
 	const double getInfectionRate() { return infectionRate; }
 
+	// Elementary event statistics.
+	static const int getElementaryEventCount() { return ELEMENTARY_EVENT_COUNT; }
+	static const string getElementaryEventName(int elementaryEvent);
+	const long long getFiringCount(int elementaryEvent) { return firingCounts[elementaryEvent]; }
+	const long long getSearchDepth() { return searchDepth; }
+	const Summary getSummary();
+
 	// Simulation methods.
+	double performStep(double currentTime) { return (this->*stepFunction)(currentTime); }
+	void attachVariateBuffer(VariateBuffer& buffer);
+	void useGenericKernel();
 	void updateProbabilities();
 	double getTimeOfNextEvent();
 	void selectProcess();
-	void checkEvents(double time);
 	void saveIteration(double currentTime);
+	void finishRecording();
+	void trackEnsemble(double currentTime);
+
+	// Updates the end time and the metrics tracked over the trajectory with the state after a step. Called by
+	// saveIteration, and instead of it when only the summary of the simulation is output.
+	void trackIteration(double currentTime) {
+		if (aboveThreshold) {
+			timeAboveThreshold += currentTime - endTime;
+		}
+		endTime = currentTime;
+
+		if (infected > peakInfected) {
+			peakInfected = infected;
+			peakTime = currentTime;
+		}
+		aboveThreshold = infected > metricThreshold;
+
+		if (ensemble != nullptr) {
+			trackEnsemble(currentTime);
+		}
+	}
+
+	// Adds the states of the simulation on the sampling grid to the ensemble statistics (of the running thread).
+	// finishEnsemble adds the final state to the rest of the grid once the simulation has ended.
+	void attachEnsemble(EnsembleStatistics& statistics) { ensemble = &statistics; }
+	void finishEnsemble();
+
+	// Applies the condition-triggered interventions whose conditions are met. Called after every step; the timed
+	// interventions are applied by the step functions themselves, at their exact timestamps.
+	void checkEvents() {
+		if (revaccinationArmed) {
+			checkRevaccination();
+		}
+	}
+
+	// Output methods. The output file is written through the trajectory stream; when streaming, outputToFile only
+	// writes the records of the last chunk and closes it.
+	void startStreaming(OutputStream& stream, string outputFormat);
+	const void outputToFile(string outputFormat, SegmentedOutput* segments = nullptr);
+
+	// Writes the whole recorded trajectory to a stream, as outputToFile does to the file.
+	const void outputTrajectory(ostream& cout, string format);
+
+	// The thread running the simulation, reported in the TXT output (which may be written by another thread).
+	void setThreadID(int thread) { threadID = thread; }
+
+	// Drops the recorded iterations once they are written; only the summary remains valid.
+	void releaseRecords() {
+		vector<RecordedData>().swap(simulationData);
+		trajectoryLog = TrajectoryLog();
+	}
 
-	// Output methods.
-	const void outputToFile(string outputFormat);
-	
 
 private:
 
 	// SIR/SEIR process (S++).
-	const double birthChance() {
+	template <Configuration::SimulationType TYPE>
+	const double birthChance(double totalPopulation) {
 
-		if (simulationType == Configuration::SimulationType::SEIR_simplified) {
+		if constexpr (TYPE == Configuration::SimulationType::SEIR_simplified) {
 			return 0;
 		}
 
@@ -84,9 +154,10 @@ private:
 	}
 
 	// SIR/SEIR process (S--).
-	const double deathOfSusceptibleChance() {
+	template <Configuration::SimulationType TYPE>
+	const double deathOfSusceptibleChance(double susceptible) {
 
-		if (simulationType == Configuration::SimulationType::SEIR_simplified) {
+		if constexpr (TYPE == Configuration::SimulationType::SEIR_simplified) {
 			return 0;
 		}
 
@@ -94,9 +165,10 @@ private:
 	}
 
 	// SEIR/SEIR_simplified process (not in SIR, E--, I++).
-	const double sicknessChance() {
+	template <Configuration::SimulationType TYPE>
+	const double sicknessChance(double exposed) {
 
-		if (simulationType == Configuration::SimulationType::SIR) {
+		if constexpr (TYPE == Configuration::SimulationType::SIR) {
 			return 0;
 		}
 
@@ -104,9 +176,10 @@ private:
 	}
 
 	// SIR/SEIR process (I--).
-	const double deathOfInfectedChance() {
+	template <Configuration::SimulationType TYPE>
+	const double deathOfInfectedChance(double infected) {
 
-		if (simulationType == Configuration::SimulationType::SEIR_simplified) {
+		if constexpr (TYPE == Configuration::SimulationType::SEIR_simplified) {
 			return 0;
 		}
 
@@ -114,9 +187,10 @@ private:
 	}
 
 	// SIR/SEIR process (R--).
-	const double deathOfRecoveredChance() {
+	template <Configuration::SimulationType TYPE>
+	const double deathOfRecoveredChance(double recovered) {
 
-		if (simulationType == Configuration::SimulationType::SEIR_simplified) {
+		if constexpr (TYPE == Configuration::SimulationType::SEIR_simplified) {
 			return 0;
 		}
 
@@ -124,14 +198,16 @@ private:
 	}
 
 	// All processes (S--, I/E++).
-	const double infectionChance() {
+	template <Configuration::SimulationType TYPE>
+	const double infectionChance(double susceptible, double infected, double totalPopulation) {
 		return infectionRate * susceptible * infected / totalPopulation;
 	}
 
 	// SEIR/SIR process (I--).
-	const double deathDueToInfectionChance() {
+	template <Configuration::SimulationType TYPE>
+	const double deathDueToInfectionChance(double infected) {
 
-		if (simulationType == Configuration::SimulationType::SEIR_simplified) {
+		if constexpr (TYPE == Configuration::SimulationType::SEIR_simplified) {
 			return 0;
 		}
 
@@ -139,33 +215,108 @@ private:
 	}
 
 	// All processes (I--, R++).
-	const double recoveryChance() {
+	template <Configuration::SimulationType TYPE>
+	const double recoveryChance(double infected) {
 		return recoveryRate * infected;
 	}
 
 
-	// Private helper functions.
-	const string findFilename(string format) {
-		return string("output_files/output_simulation_") + to_string(id) + "." + format;
+	// Chance of the given elementary event, resolved at compile time for the given simulation type.
+	template <Configuration::SimulationType TYPE>
+	const double elementaryEventChance(int elementaryEvent, double susceptible, double exposed, double infected, double recovered, double totalPopulation) {
+		switch (elementaryEvent) {
+		case BIRTH: return birthChance<TYPE>(totalPopulation);
+		case DEATH_OF_SUSCEPTIBLE: return deathOfSusceptibleChance<TYPE>(susceptible);
+		case SICKNESS: return sicknessChance<TYPE>(exposed);
+		case DEATH_OF_INFECTED: return deathOfInfectedChance<TYPE>(infected);
+		case DEATH_OF_RECOVERED: return deathOfRecoveredChance<TYPE>(recovered);
+		case INFECTION: return infectionChance<TYPE>(susceptible, infected, totalPopulation);
+		case DEATH_DUE_TO_INFECTION: return deathDueToInfectionChance<TYPE>(infected);
+		default: return recoveryChance<TYPE>(infected);
+		}
 	}
 
-	void printData(Configuration::SimulationType simulationType, RecordedData data, ofstream& cout);
+	// Chance of the given elementary event for the simulation type of this simulation.
+	const double elementaryEventChance(int elementaryEvent, double susceptible, double exposed, double infected, double recovered, double totalPopulation) {
+		switch (simulationType) {
+		case Configuration::SimulationType::SIR:
+			return elementaryEventChance<Configuration::SimulationType::SIR>(elementaryEvent, susceptible, exposed, infected, recovered, totalPopulation);
+		case Configuration::SimulationType::SEIR:
+			return elementaryEventChance<Configuration::SimulationType::SEIR>(elementaryEvent, susceptible, exposed, infected, recovered, totalPopulation);
+		default:
+			return elementaryEventChance<Configuration::SimulationType::SEIR_simplified>(elementaryEvent, susceptible, exposed, infected, recovered, totalPopulation);
+		}
+	}
+
+	// Chance of the given elementary event in the current state.
+	const double elementaryEventChance(int elementaryEvent) {
+		return elementaryEventChance(elementaryEvent, susceptible, exposed, infected, recovered, totalPopulation);
+	}
 
-	const void outputTXT();
-	const void outputCSV();
+	// Chance of the given elementary event in a continuous state (indexed by compartment).
+	const double elementaryEventChance(int elementaryEvent, const double compartments[]) {
+		return elementaryEventChance(elementaryEvent, compartments[SUSCEPTIBLE], compartments[EXPOSED], compartments[INFECTED],
+			compartments[RECOVERED], compartments[TOTAL]);
+	}
+
+	// Private helper functions.
+	void printData(const RecordedData& data, RecordFormatter& formatter);
+
+	const void outputHeader(ostream& cout, string format, const RecordedData& initialData);
+	const void outputRecords(ostream& cout, string format);
+	const void outputFooter(ostream& cout, string format, const RecordedData& firstRecord, const RecordedData& lastRecord);
+	const void outputBinary(ostream& cout);
+
+	void recordData(const RecordedData& data) {
+		if (logRecording) {
+			trajectoryLog.append(data, appliedInterventions);
+			appliedInterventions = 0;
+			if (trajectoryStream.isStreaming() && TrajectoryStream::isChunkFull(trajectoryLog.size())) {
+				flushRecords();
+			}
+			return;
+		}
+
+		simulationData.push_back(data);
+		if (trajectoryStream.isStreaming() && TrajectoryStream::isChunkFull(simulationData.size())) {
+			flushRecords();
+		}
+	}
+	void flushRecords();
 
 private:
 
 	int id;
-	static int IDGenerator;
+	int threadID = 0;
 
 	Configuration::SimulationType simulationType;
+	Configuration::SimulationEngine engine;
+
+	// Random number stream of this simulation, and the buffer of the running thread the direct method draws from.
+	RandomGenerator rng;
+	VariateBuffer* variates = nullptr;
+
+	// Interventions. The timed ones are kept in a min-heap by time; the step functions only look at the time of
+	// the earliest one, so scheduled interventions cost nothing per elementary event.
+	enum Intervention {
+		VACCINATION,
+		REVACCINATION
+	};
 
-	// Event list.
-	double vaccinationTimestamp;
 	double vaccinationEfficiency;
 	double revaccinationEfficiency;
-	vector<Event> eventList;
+	vector<string> activeEventNames;
+
+	priority_queue<ScheduledIntervention, vector<ScheduledIntervention>, greater<ScheduledIntervention>> scheduledInterventions;
+	double nextInterventionTime = numeric_limits<double>::infinity();
+
+	// Revaccination is used and armed by the first vaccination; disarmed once it occurred.
+	bool revaccinationUsed = false;
+	bool revaccinationArmed = false;
+
+	double applyScheduledInterventions();
+	void applyIntervention(Intervention intervention);
+	void checkRevaccination();
 
 	// Fixed parameters during the simulation.
 	double mortalityRate;
@@ -187,9 +338,74 @@ private:
 	};
 
 	static const int ELEMENTARY_EVENT_COUNT = 8;
+	static const int NO_EVENT = -1;
 	double elementaryEventChances[ELEMENTARY_EVENT_COUNT];
+	double chancesTotal = 0;
+
+	void processOccurred(ElementaryEvent elementaryEvent, int count = 1);
+
+	template <Configuration::SimulationType TYPE>
+	void processOccurred(ElementaryEvent elementaryEvent, int count);
+
+	// Elementary events which can occur in each simulation type.
+	static constexpr int SIR_EVENTS[] = { BIRTH, DEATH_OF_SUSCEPTIBLE, DEATH_OF_INFECTED, DEATH_OF_RECOVERED, INFECTION, DEATH_DUE_TO_INFECTION, RECOVERY };
+	static constexpr int SEIR_EVENTS[] = { BIRTH, DEATH_OF_SUSCEPTIBLE, SICKNESS, DEATH_OF_INFECTED, DEATH_OF_RECOVERED, INFECTION, DEATH_DUE_TO_INFECTION, RECOVERY };
+	static constexpr int SEIR_SIMPLIFIED_EVENTS[] = { SICKNESS, INFECTION, RECOVERY };
+
+	// Step function of the selected engine, chosen once at construction. The engines with a state of their own
+	// step through it, so a simulation only holds the state of the engine it runs.
+	double (SimulationInfo::*stepFunction)(double currentTime);
+	unique_ptr<StepEngine> stepEngine;
+
+	double engineStep(double currentTime) { return stepEngine->step(*this, currentTime); }
+
+	template <Configuration::SimulationType TYPE>
+	double specializedDirectStep(double currentTime);
+
+	// Compartments read or changed by the elementary events.
+	enum Compartment {
+		SUSCEPTIBLE,
+		EXPOSED,
+		INFECTED,
+		RECOVERED,
+		TOTAL
+	};
 
-	void processOccurred(ElementaryEvent elementaryEvent);
+	static const int COMPARTMENT_COUNT = 5;
+
+	// Population change of each compartment caused by each elementary event.
+	int stoichiometry[ELEMENTARY_EVENT_COUNT][COMPARTMENT_COUNT];
+
+	// Dependency graph: the elementary events whose chances change when an elementary event occurs.
+	int dependentEvents[ELEMENTARY_EVENT_COUNT][ELEMENTARY_EVENT_COUNT];
+	int dependentEventCount[ELEMENTARY_EVENT_COUNT];
+
+	void buildDependencyGraph();
+	vector<vector<int>> recordedEventChanges();
+	void updateDependentProbabilities();
+
+	// Order in which the elementary events are searched and how often each of them occurred.
+	int searchOrder[ELEMENTARY_EVENT_COUNT];
+	long long firingCounts[ELEMENTARY_EVENT_COUNT];
+	long long searchDepth = 0;
+
+	double directStep(double currentTime);
+
+	const int compartmentPopulation(int compartment) {
+		switch (compartment) {
+		case SUSCEPTIBLE: return susceptible;
+		case EXPOSED: return exposed;
+		case INFECTED: return infected;
+		case RECOVERED: return recovered;
+		default: return totalPopulation;
+		}
+	}
+
+	// Incremental engine state. The running total is resummed periodically to bound the rounding error.
+	static const int RESUMMATION_INTERVAL = 4096;
+	int lastEvent = NO_EVENT;
+	bool chancesStale = true;
+	int stepsSinceResummation = 0;
 
 
 	// Changeable populations during the simulation.
@@ -210,8 +426,50 @@ private:
 
 	int deathsTotal = 0;
 
-	// Recorded data.
+	// Recorded data. With the log output type, the iterations are encoded in the trajectory log instead, along
+	// with a mask of the interventions applied since the previous one.
 	vector<RecordedData> simulationData;
+	bool logRecording = false;
+	TrajectoryLog trajectoryLog;
+	unsigned appliedInterventions = 0;
+	double endTime = 0;
+
+	// Metrics tracked after every step. The infected count held since the last step is above the threshold when
+	// aboveThreshold is set.
+	int initialPopulation = 0;
+	int initialInfectious = 0;
+	int peakInfected = 0;
+	double peakTime = 0;
+	int metricThreshold;
+	bool aboveThreshold = false;
+	double timeAboveThreshold = 0;
+
+	// Ensemble statistics, the next grid point to add to them and the compartments held since the last step.
+	EnsembleStatistics* ensemble = nullptr;
+	size_t nextEnsemblePoint = 0;
+	int ensembleState[EnsembleStatistics::COMPARTMENT_COUNT];
+
+	// Fixed sampling grid (null when every step is recorded), the next grid point to record and the state held
+	// since the last step, which is the state at every grid point up to the next step.
+	const vector<double>* samplingTimes = nullptr;
+	size_t nextSample = 0;
+	RecordedData heldData = RecordedData(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+
+	// Output file, and the first and last records written to it while streaming, kept for the preview.
+	TrajectoryStream trajectoryStream;
+	size_t recordsWritten = 0;
+	RecordedData firstData = RecordedData(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+	RecordedData lastData = RecordedData(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+};
+
+struct SimulationInfo::Summary {
+	double endTime;
+	double mortalityRate;
+	double infectedMortalityRate;
+	double recoveryRate;
+	double incubationPeriod;
+	double infectionRate;
+	TrajectoryMetrics metrics;
 };
 
 #endif
\ No newline at end of file
@@ -1,100 +1,691 @@
 #include "Simulator.h"
 #include "SimulationInfo.h"
+#include "BatchSimulator.h"
 #include <chrono>
 #include <string>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <sstream>
+#include <algorithm>
 #include <omp.h>
 
 void Simulator::simulate() {
 
+	// Custom models run on the reaction network engine.
+	if (config.getEngine() == Configuration::SimulationEngine::REACTION_NETWORK) {
+		simulateNetwork();
+		return;
+	}
+
+	// The batch engine advances several simulations in lockstep on each thread.
+	if (config.getEngine() == Configuration::SimulationEngine::BATCH) {
+		simulateBatches();
+		return;
+	}
+
+	bool streaming = config.getStreamOutput();
+	bool summaryOnly = config.getOutputFormat() == "summary";
+
+	// Every thread draws the random variates of its running simulation through its own buffer.
+	vector<VariateBuffer> threadVariates(config.GetThreadCount());
+
+	runSimulations(1, false, [&](int first, int count) {
+
+		VariateBuffer& variates = threadVariates[omp_get_thread_num()];
+
+		for (int i = first; i < first + count; i++) {
+			if (summaryOnly) {
+				SimulationInfo simulationInfo(config, firstSimulationID + i);
+
+				runSummarySimulation(simulationInfo, variates);
+				finishSimulation(i, simulationInfo);
+			}
+			else if (streaming) {
+				SimulationInfo simulationInfo(config, firstSimulationID + i);
+				OutputStream stream;
+
+				simulationInfo.setThreadID(omp_get_thread_num());
+				simulationInfo.startStreaming(stream, config.getOutputFormat());
+				runSimulation(simulationInfo, variates);
+				finishSimulation(i, simulationInfo);
+			}
+			else {
+				simulationInfos[i].setThreadID(omp_get_thread_num());
+				runSimulation(simulationInfos[i], variates);
+				finishSimulation(i, simulationInfos[i]);
+			}
+		}
+	});
+}
+
+template <typename RunBlock>
+void Simulator::runSimulations(int blockSize, bool balanced, RunBlock runBlock) {
+
 	// Measure time.
 	startTime = std::chrono::steady_clock::now();
-	
-	// Each SimulationInfo calculates a random set of populations and parameters internally.
-	for (int i = 0; i < config.getNumberOfSimulations(); i++) {
-		simulationInfos.push_back(SimulationInfo(config));
+
+	bool network = config.getEngine() == Configuration::SimulationEngine::REACTION_NETWORK;
+	int simulationCount = config.getNumberOfSimulations();
+
+	// Each simulation calculates a random set of populations and parameters internally. When the output is
+	// streamed or only the summaries are output, the threads construct the simulations they run instead, so only
+	// the running ones are in memory.
+	firstSimulationID = TrajectoryStream::reserveIDs(simulationCount);
+	if (!config.getStreamOutput() && config.getOutputFormat() != "summary") {
+		for (int i = 0; i < simulationCount; i++) {
+			if (network) {
+				networkSimulations.push_back(NetworkSimulation(config, &config.getNetwork(), firstSimulationID + i));
+			}
+			else {
+				simulationInfos.push_back(SimulationInfo(config, firstSimulationID + i));
+			}
+		}
+	}
+
+	startOutput(firstSimulationID, simulationCount);
+
+	// When only the summaries are output, their rows are written out after every round of simulations, so only
+	// the summaries of one round are held (about 1.5 MB per thread, whatever the number of simulations). Otherwise all of them
+	// are output at the end of the run.
+	bool summaryOnly = config.getOutputFormat() == "summary";
+	int roundSize = simulationCount;
+	ofstream summaryFile;
+	if (summaryOnly) {
+		roundSize = config.GetThreadCount() * SUMMARY_ROUND_SIZE;
+		summaryFile.open("output_files/output_simulations_all.csv");
+		outputAggreggatedHeader(summaryFile);
+	}
+
+	if (network) {
+		networkSummaries.resize(simulationCount);
+		startEventTotals(config.getNetwork().getReactionCount());
+	}
+	else {
+		summaries.resize(min(roundSize, simulationCount));
+		startEventTotals(SimulationInfo::getElementaryEventCount());
 	}
+	startEnsemble();
 
-	// Create the otuput directory (if it doesn't exist).
-	system("mkdir output_files");
+	for (firstSummaryIndex = 0; firstSummaryIndex < simulationCount; firstSummaryIndex += roundSize) {
+		int roundEnd = min(firstSummaryIndex + roundSize, simulationCount);
+		int firstBlock = firstSummaryIndex / blockSize;
+		int blockCount = (roundEnd + blockSize - 1) / blockSize;
 
-	// Issue a pragma directive to the OpenMP library to create threads at this point.
+		// Issue a pragma directive to the OpenMP library to create threads at this point. Blocks of very different
+		// lengths are balanced over the threads as they finish.
+		if (balanced) {
+#pragma omp parallel for schedule(dynamic) num_threads(config.GetThreadCount())
+			for (int block = firstBlock; block < blockCount; block++) {
+				int first = block * blockSize;
+				runBlock(first, min(blockSize, roundEnd - first));
+			}
+		}
+		else {
 #pragma omp parallel for num_threads(config.GetThreadCount())
-	// For each simulation info.
-	for (int i = 0; i < (int)simulationInfos.size(); i++) {
+			for (int block = firstBlock; block < blockCount; block++) {
+				int first = block * blockSize;
+				runBlock(first, min(blockSize, roundEnd - first));
+			}
+		}
+		// ---> Implicit thread synchronisation point.
+
+		if (summaryOnly) {
+			outputAggreggatedRows(summaryFile, roundEnd - firstSummaryIndex);
+		}
+	}
+
+	summaryFile.close();
+
+	finishOutput();
+
+	// Stop measuring time.
+	endTime = std::chrono::steady_clock::now();
+
+	outputRunResults();
+}
 
-		double currentSimulatedTime = 0;
-		SimulationInfo& simulationInfo = simulationInfos[i];
+void Simulator::finishSimulation(int index, SimulationInfo& simulationInfo) {
+	SimulationInfo::Summary& summary = summaries[index - firstSummaryIndex];
 
-		// Save simulation info with time = 0.
+	summary = simulationInfo.getSummary();
+	addEventTotals(simulationInfo);
+	addDistributions(summary);
+}
+
+void Simulator::finishSimulation(int index, NetworkSimulation& networkSimulation) {
+	networkSummaries[index] = networkSimulation.getSummary();
+	addEventTotals(networkSimulation);
+}
+
+void Simulator::runSimulation(SimulationInfo& simulationInfo, VariateBuffer& variates) {
+
+	double currentSimulatedTime = 0;
+	simulationInfo.attachVariateBuffer(variates);
+	if (!ensembleStatistics.empty()) {
+		simulationInfo.attachEnsemble(ensembleStatistics[omp_get_thread_num()]);
+	}
+
+	// Save simulation info with time = 0.
+	simulationInfo.saveIteration(currentSimulatedTime);
+
+	while (config.getMaximumDuration() != 0 ? (currentSimulatedTime < config.getMaximumDuration() && simulationInfo.getInfectousCount() > 0) : simulationInfo.getInfectousCount() > 0) {
+
+		currentSimulatedTime = simulationInfo.performStep(currentSimulatedTime);
+		simulationInfo.checkEvents();
+
+		// Save iteration results for file output at the end of the simulation.
 		simulationInfo.saveIteration(currentSimulatedTime);
 
-		while (config.getMaximumDuration() != 0 ? (currentSimulatedTime < config.getMaximumDuration() && simulationInfo.getInfectousCount() > 0) : simulationInfo.getInfectousCount() > 0) {
+		// End simulations lasting longer than two years.
+		if (currentSimulatedTime > 730) {
+			break;
+		}
+	}
 
-			simulationInfo.updateProbabilities();
-			currentSimulatedTime += simulationInfo.getTimeOfNextEvent();
-			simulationInfo.selectProcess();
-			simulationInfo.checkEvents(currentSimulatedTime);
+	simulationInfo.finishRecording();
+	simulationInfo.finishEnsemble();
 
-			// Save iteration results for file output at the end of the simulation.
-			simulationInfo.saveIteration(currentSimulatedTime);
+	// A streamed simulation is never handed to the output writer, since it only lives while it runs.
+	if (outputWriter != nullptr && !config.getStreamOutput()) {
+		outputWriter->submit(&simulationInfo);
+		return;
+	}
 
-			// End simulations lasting longer than two years.
-			if (currentSimulatedTime > 730) {
-				break;
+	simulationInfo.outputToFile(config.getOutputFormat(), segmentedOutput.get());
+	simulationInfo.releaseRecords();
+}
+
+void Simulator::runSummarySimulation(SimulationInfo& simulationInfo, VariateBuffer& variates) {
+
+	double currentSimulatedTime = 0;
+	simulationInfo.attachVariateBuffer(variates);
+	if (config.getEnsembleOutput()) {
+		simulationInfo.attachEnsemble(ensembleStatistics[omp_get_thread_num()]);
+	}
+
+	// Nothing is recorded: the statistics of the summary are updated after every step instead.
+	simulationInfo.trackIteration(currentSimulatedTime);
+
+	while (config.getMaximumDuration() != 0 ? (currentSimulatedTime < config.getMaximumDuration() && simulationInfo.getInfectousCount() > 0) : simulationInfo.getInfectousCount() > 0) {
+
+		currentSimulatedTime = simulationInfo.performStep(currentSimulatedTime);
+		simulationInfo.checkEvents();
+		simulationInfo.trackIteration(currentSimulatedTime);
+
+		// End simulations lasting longer than two years.
+		if (currentSimulatedTime > 730) {
+			break;
+		}
+	}
+
+	simulationInfo.finishEnsemble();
+}
+
+void Simulator::simulateBatches() {
+
+	bool streaming = config.getStreamOutput();
+	bool summaryOnly = config.getOutputFormat() == "summary";
+
+	// Each thread takes blocks of simulations and keeps all lanes of its batch simulator busy with them.
+	runSimulations(BATCH_BLOCK_SIZE, true, [&](int first, int count) {
+
+		// When streaming or only outputting the summaries, the simulations of the block only exist while it runs.
+		vector<SimulationInfo> blockSimulations;
+		SimulationInfo* simulations;
+		if (streaming || summaryOnly) {
+			blockSimulations.reserve(count);
+			for (int i = 0; i < count; i++) {
+				blockSimulations.push_back(SimulationInfo(config, firstSimulationID + first + i));
+			}
+			simulations = blockSimulations.data();
+		}
+		else {
+			simulations = &simulationInfos[first];
+		}
+
+		if (!ensembleStatistics.empty()) {
+			for (int i = 0; i < count; i++) {
+				simulations[i].attachEnsemble(ensembleStatistics[omp_get_thread_num()]);
+			}
+		}
+
+		BatchSimulator batchSimulator(config, simulations, count, !summaryOnly, outputWriter.get(), segmentedOutput.get());
+		batchSimulator.run();
+
+		for (int i = 0; i < count; i++) {
+			simulations[i].finishEnsemble();
+			finishSimulation(first + i, simulations[i]);
+		}
+	});
+}
+
+void Simulator::simulateNetwork() {
+
+	const ReactionNetwork* network = &config.getNetwork();
+	bool streaming = config.getStreamOutput();
+
+	runSimulations(1, false, [&](int first, int count) {
+		for (int i = first; i < first + count; i++) {
+			if (streaming) {
+				NetworkSimulation networkSimulation(config, network, firstSimulationID + i);
+				OutputStream stream;
+
+				networkSimulation.setThreadID(omp_get_thread_num());
+				networkSimulation.startStreaming(stream, config.getOutputFormat());
+				runNetworkSimulation(networkSimulation);
+				finishSimulation(i, networkSimulation);
+			}
+			else {
+				networkSimulations[i].setThreadID(omp_get_thread_num());
+				runNetworkSimulation(networkSimulations[i]);
+				finishSimulation(i, networkSimulations[i]);
 			}
 		}
+	});
+}
+
+void Simulator::runNetworkSimulation(NetworkSimulation& networkSimulation) {
 
-		simulationInfo.outputToFile(config.getOutputFormat());
+	double currentSimulatedTime = 0;
+
+	networkSimulation.saveIteration(currentSimulatedTime);
+
+	while (config.getMaximumDuration() != 0 ? (currentSimulatedTime < config.getMaximumDuration() && networkSimulation.getInfectousCount() > 0) : networkSimulation.getInfectousCount() > 0) {
+
+		currentSimulatedTime = networkSimulation.performStep(currentSimulatedTime);
+		networkSimulation.saveIteration(currentSimulatedTime);
+
+		// End simulations lasting longer than two years.
+		if (currentSimulatedTime > 730) {
+			break;
+		}
 	}
-	// ---> Implicit thread synchronisation point.
 
-	// Stop measuring time.
-	endTime = std::chrono::steady_clock::now();
+	networkSimulation.finishRecording();
+
+	if (outputWriter != nullptr && !config.getStreamOutput()) {
+		outputWriter->submit(&networkSimulation);
+		return;
+	}
+
+	networkSimulation.outputToFile(config.getOutputFormat(), segmentedOutput.get());
+	networkSimulation.releaseRecords();
+}
+
+void Simulator::startOutput(int firstID, int simulationCount) {
+
+	// Create the output directory (if it doesn't exist).
+	std::error_code error;
+	std::filesystem::create_directories("output_files", error);
+	if (error) {
+		cerr << "ERROR: The output directory output_files cannot be created: " << error.message() << endl;
+		exit(1);
+	}
+
+	// Consolidated output is never streamed (rejected by the parser).
+	if (config.getOutputSegmentCount() > 0) {
+		string extension = config.getOutputFormat() + OutputStream::getExtension(config.getOutputCompression());
+		segmentedOutput.reset(new SegmentedOutput(config.getOutputSegmentCount(), extension, firstID, simulationCount));
+	}
+
+	// Streamed simulations write their chunks while they run, so only buffered output is handed to writer threads
+	// (and there is none when only the summaries are output).
+	if (config.getOutputThreadCount() > 0 && !config.getStreamOutput() && config.getOutputFormat() != "summary") {
+		outputWriter.reset(new OutputWriter(config.getOutputThreadCount(), config.getOutputFormat(), segmentedOutput.get()));
+	}
+}
+
+void Simulator::finishOutput() {
+	if (outputWriter != nullptr) {
+		outputWriter->finish();
+	}
+	if (segmentedOutput != nullptr) {
+		segmentedOutput->finish();
+	}
+}
+
+template <typename RowFormat>
+void Simulator::outputRows(ostream& stream, size_t rowCount, RowFormat formatRow) {
+
+	// The threads format a round of blocks at a time, so only that round is held in memory.
+	int threadCount = config.GetThreadCount();
+	size_t blockCount = (rowCount + ROW_BLOCK_SIZE - 1) / ROW_BLOCK_SIZE;
+	vector<string> blocks(threadCount * ROW_BLOCKS_PER_THREAD);
+
+	for (size_t firstBlock = 0; firstBlock < blockCount; firstBlock += blocks.size()) {
+		int roundBlocks = (int)min(blocks.size(), blockCount - firstBlock);
+
+#pragma omp parallel for schedule(dynamic) num_threads(threadCount)
+		for (int block = 0; block < roundBlocks; block++) {
+			size_t first = (firstBlock + block) * ROW_BLOCK_SIZE;
+			size_t last = min(first + ROW_BLOCK_SIZE, rowCount);
+
+			ostringstream buffer;
+			{
+				RecordFormatter formatter(buffer);
+				for (size_t row = first; row < last; row++) {
+					formatRow(formatter, row);
+				}
+			}
+			blocks[block] = buffer.str();
+		}
+
+		for (int block = 0; block < roundBlocks; block++) {
+			stream.write(blocks[block].data(), blocks[block].size());
+		}
+	}
+}
+
+void Simulator::outputRunResults() {
 
 	// Output aggreggated data.
-	outputAggreggatedData();
+	if (config.getEngine() == Configuration::SimulationEngine::REACTION_NETWORK) {
+		outputAggreggatedNetworkData();
+	}
+	else if (config.getOutputFormat() != "summary") {
+		outputAggreggatedData();
+	}
+	if (!ensembleStatistics.empty()) {
+		outputEnsembleData();
+	}
+	if (config.getQuantileOutput()) {
+		outputDistributions();
+	}
 
-	// std::cout << "Time difference = " << std::chrono::duration_cast<std::chrono::nanoseconds> (end - begin).count() << "[ns]" << std::endl;
+	// Print the performance summary of the run.
+	outputRunReport();
 }
 
-void Simulator::outputAggreggatedData() {
+void Simulator::outputAggreggatedNetworkData() {
 	string filename = "output_files/output_simulations_all.csv";
 
 	ofstream cout;
 
 	cout.open(filename);
 
-	cout << "Epidemic End,Mortality Rate, Infected Mortality Rate, Recovery Rate, Incubation Period, Infection Rate" << endl;
-	for (SimulationInfo simulation : simulationInfos) {
-		cout << simulation.getSimulationData()[simulation.getSimulationData().size() - 1].timestamp << ",";
-		cout << simulation.getMortalityRate() << ",";
-		cout << simulation.getInfectedMortalityRate() << ",";
-		cout << simulation.getRecoveryRate() << ",";
-		cout << simulation.getIncubationPeriod() << ",";
-		cout << simulation.getInfectionRate() << endl;
+	ReactionNetwork& network = config.getNetwork();
+	int parameterCount = network.getParameterCount();
+
+	cout << "Epidemic End";
+	for (int i = 0; i < parameterCount; i++) {
+		cout << "," << network.getParameterName(i);
 	}
-	
+	cout << endl;
+
+	outputRows(cout, networkSummaries.size(), [&](RecordFormatter& formatter, size_t row) {
+		const NetworkSimulation::Summary& summary = networkSummaries[row];
+
+		formatter.append(summary.endTime);
+		for (int i = 0; i < parameterCount; i++) {
+			formatter.append(',');
+			formatter.append(summary.parameters[i]);
+		}
+		formatter.append('\n');
+	});
+
+	cout.close();
+}
+
+void Simulator::outputAggreggatedData() {
+	string filename = "output_files/output_simulations_all.csv";
+
+	ofstream cout;
+
+	cout.open(filename);
+	outputAggreggatedHeader(cout);
+	outputAggreggatedRows(cout, summaries.size());
 	cout.close();
 }
 
+void Simulator::outputAggreggatedHeader(ostream& cout) {
+
+	const vector<Configuration::TrajectoryMetric>& metrics = config.getMetrics();
+
+	cout << "Epidemic End,Mortality Rate, Infected Mortality Rate, Recovery Rate, Incubation Period, Infection Rate";
+	for (Configuration::TrajectoryMetric metric : metrics) {
+		switch (metric) {
+		case Configuration::TrajectoryMetric::PEAK_INFECTED:
+			cout << ", Peak Infected";
+			break;
+		case Configuration::TrajectoryMetric::TIME_OF_PEAK:
+			cout << ", Time of Peak";
+			break;
+		case Configuration::TrajectoryMetric::FINAL_SIZE:
+			cout << ", Final Size";
+			break;
+		case Configuration::TrajectoryMetric::ATTACK_RATE:
+			cout << ", Attack Rate";
+			break;
+		case Configuration::TrajectoryMetric::TIME_ABOVE_THRESHOLD:
+			cout << ", Time Above Threshold";
+			break;
+		case Configuration::TrajectoryMetric::TOTAL_DEATHS:
+			cout << ", Total Deaths";
+			break;
+		case Configuration::TrajectoryMetric::DEATHS_BY_CAUSE:
+			cout << ", Deaths - Susceptible, Deaths - Infected, Deaths - Recovered, Deaths - Due to Infection";
+			break;
+		}
+	}
+	cout << endl;
+}
+
+void Simulator::outputAggreggatedRows(ostream& cout, size_t rowCount) {
+
+	const vector<Configuration::TrajectoryMetric>& metrics = config.getMetrics();
+
+	outputRows(cout, rowCount, [&](RecordFormatter& formatter, size_t row) {
+		const SimulationInfo::Summary& summary = summaries[row];
+
+		formatter.append(summary.endTime);
+		formatter.append(',');
+		formatter.append(summary.mortalityRate);
+		formatter.append(',');
+		formatter.append(summary.infectedMortalityRate);
+		formatter.append(',');
+		formatter.append(summary.recoveryRate);
+		formatter.append(',');
+		formatter.append(summary.incubationPeriod);
+		formatter.append(',');
+		formatter.append(summary.infectionRate);
+
+		const TrajectoryMetrics& values = summary.metrics;
+		for (Configuration::TrajectoryMetric metric : metrics) {
+			formatter.append(',');
+			switch (metric) {
+			case Configuration::TrajectoryMetric::PEAK_INFECTED:
+				formatter.append(values.peakInfected);
+				break;
+			case Configuration::TrajectoryMetric::TIME_OF_PEAK:
+				formatter.append(values.peakTime);
+				break;
+			case Configuration::TrajectoryMetric::FINAL_SIZE:
+				formatter.append(values.finalSize);
+				break;
+			case Configuration::TrajectoryMetric::ATTACK_RATE:
+				formatter.append(values.getAttackRate());
+				break;
+			case Configuration::TrajectoryMetric::TIME_ABOVE_THRESHOLD:
+				formatter.append(values.timeAboveThreshold);
+				break;
+			case Configuration::TrajectoryMetric::TOTAL_DEATHS:
+				formatter.append(values.getTotalDeaths());
+				break;
+			case Configuration::TrajectoryMetric::DEATHS_BY_CAUSE:
+				formatter.append(values.deathsSusceptible);
+				formatter.append(',');
+				formatter.append(values.deathsInfected);
+				formatter.append(',');
+				formatter.append(values.deathsRecovered);
+				formatter.append(',');
+				formatter.append(values.deathsDueToInfection);
+				break;
+			}
+		}
+		formatter.append('\n');
+	});
+}
+
 void Simulator::outputEnsembleData() {
 	string filename = "output_files/ensemble.csv";
 
+	// The statistics of the threads are merged into those of the first one.
+	for (size_t i = 1; i < ensembleStatistics.size(); i++) {
+		ensembleStatistics[0].merge(ensembleStatistics[i]);
+	}
+
+	ofstream cout;
+
+	if (config.getEnsembleOutput()) {
+		cout.open(filename);
+		ensembleStatistics[0].outputCSV(cout, config.getType() != Configuration::SimulationType::SIR);
+		cout.close();
+	}
+
+	if (config.getQuantileOutput()) {
+		cout.open("output_files/ensemble_quantiles.csv");
+		ensembleStatistics[0].outputQuantilesCSV(cout);
+		cout.close();
+	}
+}
+
+void Simulator::outputDistributions() {
+	string filename = "output_files/distributions.csv";
+
+	static const char* DISTRIBUTION_NAMES[DISTRIBUTION_COUNT] = { "Epidemic End", "Final Size", "Peak Infected", "Time of Peak", "Total Deaths" };
+
+	// The sketches of the threads are merged into those of the first one.
+	vector<QuantileSketch>& sketches = distributionSketches[0];
+	for (size_t thread = 1; thread < distributionSketches.size(); thread++) {
+		for (int i = 0; i < DISTRIBUTION_COUNT; i++) {
+			sketches[i].merge(distributionSketches[thread][i]);
+		}
+	}
+
 	ofstream cout;
 
 	cout.open(filename);
 
-	cout << "Susceptible,Exposed,Infected,Recovered" << endl;
-	for (SimulationInfo simulation : simulationInfos) {
-		if (simulation.getSimulationData()[simulation.getSimulationData().size() - 1].timestamp >= 29.95) {
-			cout << simulation.getSimulationData()[simulation.getSimulationData().size() - 1].susceptible << ",";
-			cout << simulation.getSimulationData()[simulation.getSimulationData().size() - 1].exposed << ",";
-			cout << simulation.getSimulationData()[simulation.getSimulationData().size() - 1].infected << ",";
-			cout << simulation.getSimulationData()[simulation.getSimulationData().size() - 1].recovered << endl;
+	cout << "Metric,Simulations,Minimum";
+	for (int i = 0; i < QuantileSketch::REPORTED_QUANTILE_COUNT; i++) {
+		cout << "," << QuantileSketch::REPORTED_QUANTILE_NAMES[i];
+	}
+	cout << ",Maximum" << endl;
+
+	for (int i = 0; i < DISTRIBUTION_COUNT; i++) {
+		cout << DISTRIBUTION_NAMES[i] << "," << sketches[i].getCount() << "," << sketches[i].getMinimum();
+		for (int j = 0; j < QuantileSketch::REPORTED_QUANTILE_COUNT; j++) {
+			cout << "," << sketches[i].getQuantile(QuantileSketch::REPORTED_QUANTILES[j]);
 		}
+		cout << "," << sketches[i].getMaximum() << endl;
 	}
 
 	cout.close();
+}
+
+void Simulator::outputRunReport() {
+
+	vector<string> eventNames;
+	vector<long long> firingCounts;
+	long long eventsTotal = 0;
+	long long searchDepthTotal = 0;
+	int simulationCount = config.getNumberOfSimulations();
+
+	if (config.getEngine() == Configuration::SimulationEngine::REACTION_NETWORK) {
+		ReactionNetwork& network = config.getNetwork();
+		for (int i = 0; i < network.getReactionCount(); i++) {
+			eventNames.push_back(network.getReactionName(i));
+		}
+	}
+	else {
+		for (int i = 0; i < SimulationInfo::getElementaryEventCount(); i++) {
+			eventNames.push_back(SimulationInfo::getElementaryEventName(i));
+		}
+	}
+
+	firingCounts.assign(eventNames.size(), 0);
+	for (EventTotals& totals : eventTotals) {
+		for (unsigned i = 0; i < eventNames.size(); i++) {
+			firingCounts[i] += totals.firingCounts[i];
+			eventsTotal += totals.firingCounts[i];
+		}
+		searchDepthTotal += totals.searchDepth;
+	}
+
+	double elapsedSeconds = std::chrono::duration_cast<std::chrono::duration<double>>(endTime - startTime).count();
+
+	cout << endl << "Run report " << endl << "-------------------" << endl;
+	cout << "Simulations: " << simulationCount << endl;
+	cout << "Elapsed time: " << elapsedSeconds << " s" << endl;
+	cout << "Elementary events: " << eventsTotal << endl;
+	cout << "Events per second: " << (elapsedSeconds > 0 ? eventsTotal / elapsedSeconds : 0) << endl;
+	cout << "Time per event: " << (eventsTotal > 0 ? elapsedSeconds * 1e9 / eventsTotal : 0) << " ns" << endl;
+	cout << "Mean search depth: " << (eventsTotal > 0 ? (double)searchDepthTotal / eventsTotal : 0) << endl << endl;
+
+	if (outputWriter != nullptr) {
+		cout << "Output threads: " << outputWriter->getWriterCount() << endl;
+		cout << "Mean output queue depth: " << outputWriter->getMeanQueueDepth() << " (maximum " << outputWriter->getMaximumQueueDepth();
+		cout << " of " << OutputWriter::QUEUE_CAPACITY << ")" << endl;
+		cout << "Time blocked on output: " << outputWriter->getBlockedSeconds() << " s" << endl << endl;
+	}
+
+	cout << "Firing histogram: " << endl;
+	for (unsigned i = 0; i < eventNames.size(); i++) {
+		cout << eventNames[i] << ": " << firingCounts[i];
+		cout << " (" << (eventsTotal > 0 ? 100.0 * firingCounts[i] / eventsTotal : 0) << "%)" << endl;
+	}
+}
+
+void Simulator::startEventTotals(int eventCount) {
+	eventTotals.assign(config.GetThreadCount(), EventTotals());
+	for (EventTotals& totals : eventTotals) {
+		totals.firingCounts.assign(eventCount, 0);
+	}
+}
+
+void Simulator::startEnsemble() {
+
+	// The quantile bands are kept with the ensemble statistics, on the sampling grid.
+	bool gridQuantiles = config.getQuantileOutput() && !config.getSamplingTimes().empty();
+	if (config.getEnsembleOutput() || gridQuantiles) {
+		ensembleStatistics.assign(config.GetThreadCount(), EnsembleStatistics(config.getSamplingTimes(), gridQuantiles));
+	}
+
+	if (config.getQuantileOutput()) {
+		vector<QuantileSketch> sketches;
+		for (int i = 0; i < DISTRIBUTION_COUNT; i++) {
+			sketches.push_back(QuantileSketch(i != END_TIME_DISTRIBUTION && i != PEAK_TIME_DISTRIBUTION));
+		}
+		distributionSketches.assign(config.GetThreadCount(), sketches);
+	}
+}
+
+void Simulator::addDistributions(const SimulationInfo::Summary& summary) {
+	if (distributionSketches.empty()) {
+		return;
+	}
+
+	vector<QuantileSketch>& sketches = distributionSketches[omp_get_thread_num()];
+	sketches[END_TIME_DISTRIBUTION].add(summary.endTime);
+	sketches[FINAL_SIZE_DISTRIBUTION].add(summary.metrics.finalSize);
+	sketches[PEAK_INFECTED_DISTRIBUTION].add(summary.metrics.peakInfected);
+	sketches[PEAK_TIME_DISTRIBUTION].add(summary.metrics.peakTime);
+	sketches[TOTAL_DEATHS_DISTRIBUTION].add(summary.metrics.getTotalDeaths());
+}
+
+void Simulator::addEventTotals(SimulationInfo& simulationInfo) {
+	EventTotals& totals = eventTotals[omp_get_thread_num()];
+	for (int i = 0; i < SimulationInfo::getElementaryEventCount(); i++) {
+		totals.firingCounts[i] += simulationInfo.getFiringCount(i);
+	}
+	totals.searchDepth += simulationInfo.getSearchDepth();
+}
+
+void Simulator::addEventTotals(NetworkSimulation& networkSimulation) {
+	EventTotals& totals = eventTotals[omp_get_thread_num()];
+	for (unsigned i = 0; i < totals.firingCounts.size(); i++) {
+		totals.firingCounts[i] += networkSimulation.getFiringCount(i);
+	}
+	totals.searchDepth += networkSimulation.getSearchDepth();
 }
\ No newline at end of file
@@ -4,7 +4,14 @@
 
 #include "Configuration.h"
 #include "SimulationInfo.h"
+#include "NetworkSimulation.h"
+#include "OutputWriter.h"
+#include "SegmentedOutput.h"
+#include "RecordFormatter.h"
+#include "EnsembleStatistics.h"
+#include "QuantileSketch.h"
 #include <chrono>
+#include <memory>
 
 class Simulator {
 
@@ -16,14 +23,89 @@ public:
 
 private:
 
+	// Number of simulations handed to a batch simulator at once.
+	static const int BATCH_BLOCK_SIZE = 64;
+
+	// Number of rows of the aggregated output formatted by a thread at once, and blocks per thread in a round.
+	static const size_t ROW_BLOCK_SIZE = 4096;
+	static const int ROW_BLOCKS_PER_THREAD = 4;
+
+	// Simulations per thread in a round, when only the summaries are output (a multiple of BATCH_BLOCK_SIZE).
+	static const int SUMMARY_ROUND_SIZE = 16384;
+
 	// Private helper functions.
+	void runSimulation(SimulationInfo& simulationInfo, VariateBuffer& variates);
+	void runSummarySimulation(SimulationInfo& simulationInfo, VariateBuffer& variates);
+	void simulateBatches();
+	void simulateNetwork();
+
+	// The simulation driver of every engine: reserves the IDs of the simulations, stores them when their output is
+	// not streamed, runs blocks of blockSize simulations on the threads through runBlock(first, count) (balanced
+	// as the threads finish them, or split evenly), and outputs the results of the run.
+	template <typename RunBlock>
+	void runSimulations(int blockSize, bool balanced, RunBlock runBlock);
+	void finishSimulation(int index, SimulationInfo& simulationInfo);
+	void finishSimulation(int index, NetworkSimulation& networkSimulation);
+	void runNetworkSimulation(NetworkSimulation& networkSimulation);
+	void startOutput(int firstID, int simulationCount);
+	void finishOutput();
+	void outputRunResults();
 	void outputAggreggatedData();
+	void outputAggreggatedHeader(ostream& cout);
+	void outputAggreggatedRows(ostream& cout, size_t rowCount);
+	void outputAggreggatedNetworkData();
 	void outputEnsembleData();
+	template <typename RowFormat>
+	void outputRows(ostream& stream, size_t rowCount, RowFormat formatRow);
+	void outputRunReport();
+	void startEventTotals(int eventCount);
+	void startEnsemble();
+	void addDistributions(const SimulationInfo::Summary& summary);
+	void outputDistributions();
+	void addEventTotals(SimulationInfo& simulationInfo);
+	void addEventTotals(NetworkSimulation& networkSimulation);
 
 	long maximumTime;
 	Configuration config;
 
+	// ID of the first simulation of the run, and index of the simulation of the first summary held.
+	int firstSimulationID = 0;
+	int firstSummaryIndex = 0;
+
+	// The simulations are only kept here until the end of the run when their output is not streamed.
 	vector<SimulationInfo> simulationInfos;
+	vector<NetworkSimulation> networkSimulations;
+
+	vector<SimulationInfo::Summary> summaries;
+	vector<NetworkSimulation::Summary> networkSummaries;
+
+	// Elementary event statistics for the run report, summed by every thread over the simulations it ran (so the
+	// summaries do not have to hold them).
+	struct EventTotals {
+		vector<long long> firingCounts;
+		long long searchDepth = 0;
+	};
+	vector<EventTotals> eventTotals;
+
+	// Ensemble statistics on the sampling grid, one per thread until they are merged for the output.
+	vector<EnsembleStatistics> ensembleStatistics;
+
+	// Quantile sketches of the distributions of summary metrics over the simulations, one set per thread.
+	enum Distribution {
+		END_TIME_DISTRIBUTION,
+		FINAL_SIZE_DISTRIBUTION,
+		PEAK_INFECTED_DISTRIBUTION,
+		PEAK_TIME_DISTRIBUTION,
+		TOTAL_DEATHS_DISTRIBUTION,
+		DISTRIBUTION_COUNT
+	};
+	vector<vector<QuantileSketch>> distributionSketches;
+
+	// Dedicated output threads (none when the simulation threads write the output files themselves).
+	unique_ptr<OutputWriter> outputWriter;
+
+	// Segment files holding all trajectories (none when every simulation writes a file of its own).
+	unique_ptr<SegmentedOutput> segmentedOutput;
 
 	std::chrono::steady_clock::time_point startTime, endTime;
 
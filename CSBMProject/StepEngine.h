@@ -0,0 +1,20 @@
+#ifndef _STEPENGINE_H_
+
+#define _STEPENGINE_H_
+
+class SimulationInfo;
+
+// State and step function of an engine which needs more than the compartments and chances of the simulation
+// (next reaction method, tau-leaping, chemical Langevin and mean-field engines). A simulation only owns the
+// engine it runs; the direct method engines step on the state of the simulation itself.
+class StepEngine {
+
+public:
+
+	virtual ~StepEngine() {}
+
+	// Advances the simulation by one step from currentTime and returns the time reached.
+	virtual double step(SimulationInfo& simulation, double currentTime) = 0;
+};
+
+#endif
@@ -0,0 +1,128 @@
+#include "TauLeapingEngine.h"
+
+#include <limits>
+#include <cmath>
+#include <algorithm>
+
+double TauLeapingEngine::step(SimulationInfo& simulation, double currentTime) {
+
+	// Small populations are simulated exactly for a number of steps.
+	if (remainingExactSteps > 0) {
+		remainingExactSteps--;
+		return simulation.directStep(currentTime);
+	}
+
+	simulation.updateProbabilities();
+
+	if (simulation.chancesTotal == 0) {
+		return numeric_limits<double>::infinity();
+	}
+
+	// Critical events could exhaust one of their reactant compartments within a few firings.
+	bool critical[SimulationInfo::ELEMENTARY_EVENT_COUNT];
+	double criticalChancesTotal = 0;
+	for (int i = 0; i < SimulationInfo::ELEMENTARY_EVENT_COUNT; i++) {
+		critical[i] = false;
+		if (simulation.elementaryEventChances[i] == 0) {
+			continue;
+		}
+		for (int j = 0; j < SimulationInfo::TOTAL; j++) {
+			if (simulation.stoichiometry[i][j] < 0 && simulation.compartmentPopulation(j) / -simulation.stoichiometry[i][j] < CRITICAL_FIRINGS) {
+				critical[i] = true;
+			}
+		}
+		if (critical[i]) {
+			criticalChancesTotal += simulation.elementaryEventChances[i];
+		}
+	}
+
+	// Select the leap so that the expected relative change of every compartment stays within the error bound.
+	// The infection is of second order in the susceptible and infected compartments.
+	const double highestOrder[SimulationInfo::TOTAL] = { 2, 1, 2, 1 };
+	double leap = numeric_limits<double>::infinity();
+	for (int j = 0; j < SimulationInfo::TOTAL; j++) {
+		double mean = 0;
+		double variance = 0;
+		for (int i = 0; i < SimulationInfo::ELEMENTARY_EVENT_COUNT; i++) {
+			if (!critical[i]) {
+				mean += simulation.stoichiometry[i][j] * simulation.elementaryEventChances[i];
+				variance += simulation.stoichiometry[i][j] * simulation.stoichiometry[i][j] * simulation.elementaryEventChances[i];
+			}
+		}
+
+		double bound = max(TAU_LEAPING_ERROR * simulation.compartmentPopulation(j) / highestOrder[j], 1.0);
+		if (mean != 0) {
+			leap = min(leap, bound / fabs(mean));
+		}
+		if (variance != 0) {
+			leap = min(leap, bound * bound / variance);
+		}
+	}
+
+	// Leaping over only a handful of events is not worth the approximation.
+	if (leap < EXACT_STEP_THRESHOLD / simulation.chancesTotal) {
+		remainingExactSteps = EXACT_STEP_COUNT - 1;
+		return simulation.directStep(currentTime);
+	}
+
+	// Leaps end at the next intervention at the latest.
+	double interventionLeap = simulation.nextInterventionTime - currentTime;
+	leap = min(leap, interventionLeap);
+
+	while (true) {
+		double criticalLeap = criticalChancesTotal > 0 ? simulation.rng.nextExponential(criticalChancesTotal) : numeric_limits<double>::infinity();
+		double tau = min(leap, criticalLeap);
+
+		int counts[SimulationInfo::ELEMENTARY_EVENT_COUNT];
+		for (int i = 0; i < SimulationInfo::ELEMENTARY_EVENT_COUNT; i++) {
+			counts[i] = critical[i] ? 0 : (int)simulation.rng.nextPoisson(simulation.elementaryEventChances[i] * tau);
+		}
+
+		// At most one critical event fires during a leap.
+		if (criticalLeap <= leap) {
+			double target = simulation.rng.nextUniform() * criticalChancesTotal;
+			double linePointer = 0;
+			int selectedEvent = SimulationInfo::NO_EVENT;
+			for (int i = 0; i < SimulationInfo::ELEMENTARY_EVENT_COUNT; i++) {
+				if (critical[i]) {
+					linePointer += simulation.elementaryEventChances[i];
+					selectedEvent = i;
+					if (target < linePointer) {
+						break;
+					}
+				}
+			}
+			counts[selectedEvent] = 1;
+		}
+
+		// Reject leaps which would make a compartment negative and retry with half the leap.
+		bool negative = false;
+		for (int j = 0; j < SimulationInfo::TOTAL; j++) {
+			long long population = simulation.compartmentPopulation(j);
+			for (int i = 0; i < SimulationInfo::ELEMENTARY_EVENT_COUNT; i++) {
+				population += (long long)simulation.stoichiometry[i][j] * counts[i];
+			}
+			if (population < 0) {
+				negative = true;
+			}
+		}
+
+		if (negative) {
+			leap /= 2;
+			continue;
+		}
+
+		for (int i = 0; i < SimulationInfo::ELEMENTARY_EVENT_COUNT; i++) {
+			if (counts[i] > 0) {
+				simulation.processOccurred((SimulationInfo::ElementaryEvent)i, counts[i]);
+			}
+		}
+
+		simulation.chancesStale = true;
+
+		if (tau == interventionLeap) {
+			return simulation.applyScheduledInterventions();
+		}
+		return currentTime + tau;
+	}
+}
@@ -0,0 +1,27 @@
+#ifndef _TAULEAPINGENGINE_H_
+
+#define _TAULEAPINGENGINE_H_
+
+#include "StepEngine.h"
+#include "SimulationInfo.h"
+
+// Tau-leaping with the leap selection and critical events of Cao, Gillespie and Petzold. Leaps over only a few
+// events fall back to a number of exact direct method steps.
+class TauLeapingEngine : public StepEngine {
+
+public:
+
+	double step(SimulationInfo& simulation, double currentTime) override;
+
+private:
+
+	// Tuning constants.
+	static constexpr double TAU_LEAPING_ERROR = 0.03;
+	static const int CRITICAL_FIRINGS = 10;
+	static constexpr double EXACT_STEP_THRESHOLD = 10;
+	static const int EXACT_STEP_COUNT = 100;
+
+	int remainingExactSteps = 0;
+};
+
+#endif
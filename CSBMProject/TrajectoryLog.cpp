@@ -0,0 +1,346 @@
+#include "TrajectoryLog.h"
+
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <cstring>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+
+#include "RecordFormatter.h"
+
+// File header: the magic string, the simulation ID and type and the change table of the elementary events.
+static const char LOG_MAGIC[] = "CSBMLOG2";
+static const int LOG_MAGIC_LENGTH = 8;
+
+void TrajectoryLog::append(const RecordedData& data, unsigned interventions) {
+
+	int fields[FIELD_COUNT];
+	fieldsOf(data, fields);
+	int64_t digits;
+	int exponent;
+	quantizeTime(data.timestamp, digits, exponent);
+
+	// The time step is counted in units of the previous timestamp's last digit, which needs the exponent not to
+	// decrease (and not to grow so much that the count overflows).
+	int64_t step = digits;
+	bool stepped = exponent >= lastExponent && exponent - lastExponent <= 12;
+	if (stepped) {
+		for (int i = lastExponent; i < exponent; i++) {
+			step *= 10;
+		}
+		step -= lastDigits;
+	}
+
+	// The records of every chunk start with a full state, and so does every CHECKPOINT_INTERVAL-th one.
+	int code = FULL_STATE;
+	if (interventions != 0) {
+		code = INTERVENTION;
+	}
+	else if (stepped && (recordCount - firstRecord) % CHECKPOINT_INTERVAL != 0) {
+		if (equal(fields, fields + FIELD_COUNT, lastFields)) {
+			code = UNCHANGED;
+		}
+		for (unsigned event = 0; event < eventChanges.size() && code == FULL_STATE; event++) {
+			int i = 0;
+			while (i < FIELD_COUNT && fields[i] - lastFields[i] == eventChanges[event][i]) {
+				i++;
+			}
+			if (i == FIELD_COUNT) {
+				code = event;
+			}
+		}
+	}
+
+	if (code == FULL_STATE || code == INTERVENTION) {
+		checkpointIndices.push_back(recordCount);
+		checkpointOffsets.push_back(bytes.size());
+	}
+
+	bytes.push_back((uint8_t)code);
+
+	if (code == FULL_STATE || code == INTERVENTION) {
+		if (code == INTERVENTION) {
+			putVarint(bytes, interventions);
+		}
+		putVarint(bytes, digits);
+		putVarint(bytes, zigzag(exponent));
+		for (int i = 0; i < FIELD_COUNT; i++) {
+			putVarint(bytes, zigzag(fields[i]));
+		}
+	}
+	else {
+		putVarint(bytes, zigzag(step));
+	}
+
+	lastDigits = digits;
+	lastExponent = exponent;
+	copy(fields, fields + FIELD_COUNT, lastFields);
+	recordCount++;
+}
+
+void TrajectoryLog::writeHeader(ostream& stream, int simulationID, Configuration::SimulationType simulationType) const {
+
+	vector<uint8_t> header(LOG_MAGIC, LOG_MAGIC + LOG_MAGIC_LENGTH);
+
+	putVarint(header, simulationID);
+	putVarint(header, simulationType);
+	putVarint(header, eventChanges.size());
+	for (const vector<int>& changes : eventChanges) {
+		for (int i = 0; i < FIELD_COUNT; i++) {
+			putVarint(header, zigzag(changes[i]));
+		}
+	}
+
+	stream.write((const char*)header.data(), header.size());
+}
+
+void TrajectoryLog::writeRecords(ostream& stream) {
+
+	stream.write((const char*)bytes.data(), bytes.size());
+
+	// Clearing keeps the capacity, so the chunk is reused for the next records.
+	bytes.clear();
+	checkpointIndices.clear();
+	checkpointOffsets.clear();
+	firstRecord = recordCount;
+}
+
+bool TrajectoryLog::load(string filename) {
+
+	ifstream file(filename, ios::binary);
+	if (!file) {
+		return false;
+	}
+
+	vector<uint8_t> content((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+	if (content.size() < LOG_MAGIC_LENGTH || memcmp(content.data(), LOG_MAGIC, LOG_MAGIC_LENGTH) != 0) {
+		return false;
+	}
+
+	// Pad the content with zeros (a zero byte ends a varint), so a truncated record is not decoded past the end.
+	size_t contentSize = content.size();
+	content.resize(contentSize + FIELD_COUNT + 3 * sizeof(uint64_t), 0);
+
+	const uint8_t* position = content.data() + LOG_MAGIC_LENGTH;
+	simulationID = (int)getVarint(position);
+
+	uint64_t type = getVarint(position);
+	if (type != Configuration::SimulationType::SIR && type != Configuration::SimulationType::SEIR &&
+		type != Configuration::SimulationType::SEIR_simplified) {
+		return false;
+	}
+	simulationType = (Configuration::SimulationType)type;
+
+	uint64_t eventCount = getVarint(position);
+	if (eventCount >= FULL_STATE) {
+		return false;
+	}
+	eventChanges.assign(eventCount, vector<int>(FIELD_COUNT));
+	for (vector<int>& changes : eventChanges) {
+		for (int i = 0; i < FIELD_COUNT; i++) {
+			changes[i] = (int)unzigzag(getVarint(position));
+		}
+	}
+
+	checkpointIndices.clear();
+	checkpointOffsets.clear();
+	firstRecord = recordCount = 0;
+
+	// Decode all records once, checking the record codes and indexing the full states on the way.
+	const uint8_t* begin = position;
+	const uint8_t* end = content.data() + contentSize;
+
+	int64_t digits = 0;
+	int exponent = 0;
+	int fields[FIELD_COUNT] = {};
+	while (position < end) {
+		int code = *position;
+		if (code == FULL_STATE || code == INTERVENTION) {
+			checkpointIndices.push_back(recordCount);
+			checkpointOffsets.push_back(position - begin);
+		}
+		else if (code != UNCHANGED && code >= (int)eventChanges.size()) {
+			return false;
+		}
+		else if (recordCount == 0) {
+			return false;
+		}
+		position = decodeRecord(position, digits, exponent, fields);
+		recordCount++;
+	}
+
+	if (position != end) {
+		return false;
+	}
+
+	bytes.assign(begin, end);
+	lastDigits = digits;
+	lastExponent = exponent;
+	copy(fields, fields + FIELD_COUNT, lastFields);
+	return true;
+}
+
+bool TrajectoryLog::row(size_t index, RecordedData& data) {
+
+	if (index < firstRecord || index >= recordCount) {
+		return false;
+	}
+
+	int64_t digits;
+	int exponent;
+	int fields[FIELD_COUNT];
+	seekRecord(index, digits, exponent, fields);
+
+	data = dataOf(timeOf(digits, exponent), fields);
+	return true;
+}
+
+void TrajectoryLog::outputCSV(ostream& cout, size_t first, size_t last) {
+
+	bool withExposed = simulationType != Configuration::SimulationType::SIR;
+	bool withCounters = simulationType != Configuration::SimulationType::SEIR_simplified;
+
+	cout << "Time,Susceptible";
+	if (withExposed) {
+		cout << ",Exposed";
+	}
+	cout << ",Infected,Recovered,Total Population";
+	if (withCounters) {
+		cout << ",Births,Deaths - Susceptible, Deaths - Infected, Deaths - Recovered, Deaths - Due to Infection, Deaths - Total";
+	}
+	cout << endl;
+
+	first = max(first, firstRecord);
+	last = min(last, recordCount);
+	if (first >= last) {
+		return;
+	}
+
+	int64_t digits;
+	int exponent;
+	int fields[FIELD_COUNT];
+	const uint8_t* position = seekRecord(first, digits, exponent, fields);
+	RecordFormatter formatter(cout);
+
+	for (size_t record = first; record < last; record++) {
+		if (record > first) {
+			position = decodeRecord(position, digits, exponent, fields);
+		}
+
+		formatter.append(timeOf(digits, exponent));
+		for (int i = 0; i < (withCounters ? FIELD_COUNT : BIRTHS); i++) {
+			if (i != 1 || withExposed) {
+				formatter.append(',');
+				formatter.append(fields[i]);
+			}
+		}
+		formatter.append('\n');
+	}
+}
+
+const uint8_t* TrajectoryLog::decodeRecord(const uint8_t* position, int64_t& digits, int& exponent, int fields[FIELD_COUNT]) {
+
+	int code = *position++;
+
+	if (code == FULL_STATE || code == INTERVENTION) {
+		if (code == INTERVENTION) {
+			getVarint(position);
+		}
+		digits = (int64_t)getVarint(position);
+		exponent = (int)unzigzag(getVarint(position));
+		for (int i = 0; i < FIELD_COUNT; i++) {
+			fields[i] = (int)unzigzag(getVarint(position));
+		}
+		return position;
+	}
+
+	// The step is counted in units of the previous last digit; drop the zeros a larger exponent appended.
+	digits += unzigzag(getVarint(position));
+	while (digits >= 1000000 && digits % 10 == 0) {
+		digits /= 10;
+		exponent++;
+	}
+	if (code != UNCHANGED) {
+		for (int i = 0; i < FIELD_COUNT; i++) {
+			fields[i] += eventChanges[code][i];
+		}
+	}
+	return position;
+}
+
+const uint8_t* TrajectoryLog::seekRecord(size_t index, int64_t& digits, int& exponent, int fields[FIELD_COUNT]) {
+
+	// The held records start with a full state, so there is one at or before every held row.
+	size_t checkpoint = upper_bound(checkpointIndices.begin(), checkpointIndices.end(), index) - checkpointIndices.begin() - 1;
+
+	const uint8_t* position = bytes.data() + checkpointOffsets[checkpoint];
+	for (size_t record = checkpointIndices[checkpoint]; record <= index; record++) {
+		position = decodeRecord(position, digits, exponent, fields);
+	}
+	return position;
+}
+
+void TrajectoryLog::fieldsOf(const RecordedData& data, int fields[FIELD_COUNT]) {
+	fields[0] = data.susceptible;
+	fields[1] = data.exposed;
+	fields[2] = data.infected;
+	fields[3] = data.recovered;
+	fields[4] = data.total;
+	fields[5] = data.births;
+	fields[6] = data.deathsSuspectible;
+	fields[7] = data.deathsInfected;
+	fields[8] = data.deathsRecovered;
+	fields[9] = data.deathsDueToInfection;
+	fields[10] = data.deathsTotal;
+}
+
+void TrajectoryLog::quantizeTime(double timestamp, int64_t& digits, int& exponent) {
+
+	// The same rounding as the CSV files: "d.ddddde+x" holds the 6 significant digits printed there.
+	char text[32];
+	char* end = to_chars(text, text + sizeof(text), timestamp, chars_format::scientific, 5).ptr;
+	*end = '\0';
+
+	digits = text[0] - '0';
+	for (int i = 2; i < 7; i++) {
+		digits = digits * 10 + (text[i] - '0');
+	}
+	exponent = atoi(text + 8) - 5;
+}
+
+RecordedData TrajectoryLog::dataOf(double timestamp, const int fields[FIELD_COUNT]) {
+	return RecordedData(timestamp, fields[0], fields[1], fields[2], fields[3], fields[4], fields[5], fields[6], fields[7],
+		fields[8], fields[9], fields[10]);
+}
+
+double TrajectoryLog::timeOf(int64_t digits, int exponent) {
+
+	// Both factors are exact up to 10^22, so the product (or quotient) is the double nearest to the decimal.
+	static const double POWERS[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14,
+		1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+	if (exponent >= 0) {
+		return exponent <= 22 ? digits * POWERS[exponent] : digits * pow(10.0, exponent);
+	}
+	return -exponent <= 22 ? digits / POWERS[-exponent] : digits / pow(10.0, -exponent);
+}
+
+void TrajectoryLog::putVarint(vector<uint8_t>& bytes, uint64_t value) {
+	while (value >= 0x80) {
+		bytes.push_back(uint8_t(value | 0x80));
+		value >>= 7;
+	}
+	bytes.push_back(uint8_t(value));
+}
+
+uint64_t TrajectoryLog::getVarint(const uint8_t*& position) {
+	uint64_t value = 0;
+	int shift = 0;
+	while ((*position & 0x80) && shift < 63) {
+		value |= uint64_t(*position++ & 0x7f) << shift;
+		shift += 7;
+	}
+	value |= uint64_t(*position++) << shift;
+	return value;
+}
@@ -0,0 +1,108 @@
+#ifndef _TRAJECTORYLOG_H_
+
+#define _TRAJECTORYLOG_H_
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+
+#include "RecordedData.h"
+#include "Configuration.h"
+
+using namespace std;
+
+// A compact encoding of a recorded trajectory, used by the "log" output type.
+// The timestamps are rounded to the 6 significant digits of the CSV files and kept as a decimal digit count and
+// exponent, so they are lossy: a decoded timestamp is the one printed in the CSV file, not the double of the
+// simulation (or of the bin output). Most iterations of the exact engines differ from the previous one by a single
+// elementary event, so they are stored as one byte with the event followed by the time step as a varint count of
+// the previous timestamp's last digit: usually 2 bytes instead of the 56 of a RecordedData. Every other iteration
+// (interventions, leaps, grid points, a smaller decimal exponent) stores the full state, and so does every
+// CHECKPOINT_INTERVAL-th one, so any row is rebuilt on demand from the nearest full state before it.
+class TrajectoryLog {
+
+public:
+
+	static const int FIELD_COUNT = 11;
+	static const int CHECKPOINT_INTERVAL = 256;
+
+	// Fields of a state: the populations (susceptible, exposed, infected, recovered, total) and then the counters.
+	enum CounterField {
+		BIRTHS = 5,
+		DEATHS_OF_SUSCEPTIBLE,
+		DEATHS_OF_INFECTED,
+		DEATHS_OF_RECOVERED,
+		DEATHS_DUE_TO_INFECTION,
+		DEATHS_TOTAL
+	};
+
+	// Record codes. Codes below FULL_STATE are elementary events.
+	enum RecordCode {
+		FULL_STATE = 0xf0,
+		INTERVENTION = 0xf1,
+		UNCHANGED = 0xf2
+	};
+
+	// Sets the change of every field caused by each elementary event.
+	void setEventChanges(const vector<vector<int>>& changes) { eventChanges = changes; }
+
+	// Encoding. The interventions are a bit mask of the interventions applied since the previous iteration.
+	void append(const RecordedData& data, unsigned interventions = 0);
+
+	// Writes the file header, the encoded records (and drops them, so appending continues with a new chunk).
+	void writeHeader(ostream& stream, int simulationID, Configuration::SimulationType simulationType) const;
+	void writeRecords(ostream& stream);
+
+	// Decoding.
+	bool load(string filename);
+	const size_t size() { return recordCount; }
+	const int getSimulationID() { return simulationID; }
+
+	// Rebuilds the row with the given index. Returns false if the row is not held (out of range, or already
+	// written out while encoding).
+	bool row(size_t index, RecordedData& data);
+
+	// Writes the rows from first up to last (excluded) in the column layout of the CSV files of the simulation type.
+	void outputCSV(ostream& cout, size_t first = 0, size_t last = SIZE_MAX);
+
+private:
+
+	static void fieldsOf(const RecordedData& data, int fields[FIELD_COUNT]);
+	static RecordedData dataOf(double timestamp, const int fields[FIELD_COUNT]);
+
+	// Rounds a timestamp to 6 significant digits, digits * 10^exponent, and back.
+	static void quantizeTime(double timestamp, int64_t& digits, int& exponent);
+	static double timeOf(int64_t digits, int exponent);
+
+	static void putVarint(vector<uint8_t>& bytes, uint64_t value);
+	static uint64_t getVarint(const uint8_t*& position);
+	static uint64_t zigzag(int64_t value) { return (uint64_t(value) << 1) ^ uint64_t(value >> 63); }
+	static int64_t unzigzag(uint64_t value) { return int64_t(value >> 1) ^ -int64_t(value & 1); }
+
+	// Decodes the record at position into the state, and returns the position of the next one.
+	const uint8_t* decodeRecord(const uint8_t* position, int64_t& digits, int& exponent, int fields[FIELD_COUNT]);
+
+	// Decodes the records from the last full state at or before the held row with the given index up to that row,
+	// and returns the position of the next one.
+	const uint8_t* seekRecord(size_t index, int64_t& digits, int& exponent, int fields[FIELD_COUNT]);
+
+	int simulationID = 0;
+	Configuration::SimulationType simulationType = Configuration::SimulationType::SEIR;
+	vector<vector<int>> eventChanges;
+
+	// Encoded records, starting with a full state, and the index and offset of every full state kept for seeking.
+	vector<uint8_t> bytes;
+	vector<size_t> checkpointIndices;
+	vector<size_t> checkpointOffsets;
+	size_t firstRecord = 0;
+	size_t recordCount = 0;
+
+	// State of the last appended iteration.
+	int64_t lastDigits = 0;
+	int lastExponent = 0;
+	int lastFields[FIELD_COUNT] = {};
+};
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef _TRAJECTORYMETRICS_H_
+
+#define _TRAJECTORYMETRICS_H_
+
+#include <cstdint>
+
+// Epidemic metrics of a finished simulation. They are tracked while it runs, at a constant cost per step, so
+// the recorded trajectory never has to be read again to find them. The layout is also part of the segment index.
+struct TrajectoryMetrics {
+	// Largest infected count and the time it was first reached.
+	double peakTime;
+	int32_t peakInfected;
+	// Individuals ever infected: the initially exposed and infected and every infection since.
+	int32_t finalSize;
+	// Everyone who was part of the population: the initial population and the births.
+	int32_t population;
+	// Deaths by cause.
+	int32_t deathsSusceptible;
+	int32_t deathsInfected;
+	int32_t deathsRecovered;
+	int32_t deathsDueToInfection;
+	int32_t reserved;
+	// Total time the infected count was above the configured threshold.
+	double timeAboveThreshold;
+
+	double getAttackRate() const { return population > 0 ? (double)finalSize / population : 0; }
+	int getTotalDeaths() const { return deathsSusceptible + deathsInfected + deathsRecovered + deathsDueToInfection; }
+};
+
+static_assert(sizeof(TrajectoryMetrics) == 48, "The trajectory metrics must not contain padding.");
+
+#endif
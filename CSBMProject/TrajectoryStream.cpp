@@ -0,0 +1,46 @@
+#include "TrajectoryStream.h"
+
+#include <fstream>
+#include <sstream>
+
+int TrajectoryStream::IDGenerator = 0;
+
+TrajectoryStream::TrajectoryStream(Configuration& config, int simulationID) : id(simulationID) {
+	compression = config.getOutputCompression();
+	level = config.getCompressionLevel();
+}
+
+void TrajectoryStream::start(OutputStream& outputStream, string outputFormat) {
+	stream = &outputStream;
+	format = outputFormat;
+
+	// A stream reused from a previous simulation starts with the default format again.
+	stream->copyfmt(ofstream());
+	stream->open(findFilename(format), openMode(format), compression, level);
+}
+
+void TrajectoryStream::finish() {
+	stream->close();
+	stream = nullptr;
+}
+
+void TrajectoryStream::write(string outputFormat, SegmentedOutput* segments, double endTime, long long eventCount,
+	const TrajectoryMetrics& metrics, const function<void(ostream&)>& writeTrajectory) {
+
+	if (segments != nullptr) {
+		ostringstream buffer;
+		OutputStream bufferStream;
+		bufferStream.attach(buffer, compression, level);
+		writeTrajectory(bufferStream);
+		bufferStream.close();
+
+		segments->append(id, buffer.str(), endTime, eventCount, metrics);
+		return;
+	}
+
+	OutputStream file;
+
+	file.open(findFilename(outputFormat), openMode(outputFormat), compression, level);
+	writeTrajectory(file);
+	file.close();
+}
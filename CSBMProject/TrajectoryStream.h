@@ -0,0 +1,78 @@
+#ifndef _TRAJECTORYSTREAM_H_
+
+#define _TRAJECTORYSTREAM_H_
+
+#include <string>
+#include <ostream>
+#include <functional>
+
+#include "Configuration.h"
+#include "OutputStream.h"
+#include "SegmentedOutput.h"
+#include "TrajectoryMetrics.h"
+
+using namespace std;
+
+// The output file of one simulation, shared by the simulation classes, which only format their records: the name
+// and compression of the file, the consolidated segments, and the IDs of the simulations.
+//
+// When streaming, the file is opened before the first iteration is saved, and the simulation writes its records
+// out every CHUNK_SIZE iterations and drops them, so it only holds one chunk. Otherwise the whole trajectory is
+// written once the simulation ends, to a file of its own or to its segment.
+class TrajectoryStream {
+
+public:
+
+	static const int CHUNK_SIZE = 1024;
+
+	// Constructor.
+	TrajectoryStream(Configuration& config, int simulationID);
+
+	// Reserves count consecutive IDs for simulations constructed later (eg. by the threads running them), or
+	// generates the next one.
+	static int reserveIDs(int count) {
+		int first = IDGenerator;
+		IDGenerator += count;
+		return first;
+	}
+	static int generateID() { return IDGenerator++; }
+
+	// Streaming. The stream may be reused by the simulations a thread runs one after the other.
+	void start(OutputStream& outputStream, string outputFormat);
+	void finish();
+	bool isStreaming() { return stream != nullptr; }
+	ostream& getStream() { return *stream; }
+	const string& getFormat() { return format; }
+
+	// Whether the records held since the last chunk was written out fill a chunk.
+	static bool isChunkFull(size_t recordCount) { return recordCount % CHUNK_SIZE == 0; }
+
+	// Writes a whole trajectory, formatted by writeTrajectory, to the file of the simulation. With consolidated
+	// output, it is formatted (and compressed) in memory and appended to its segment with the summary instead.
+	void write(string outputFormat, SegmentedOutput* segments, double endTime, long long eventCount,
+		const TrajectoryMetrics& metrics, const function<void(ostream&)>& writeTrajectory);
+
+private:
+
+	const string findFilename(string outputFormat) {
+		return string("output_files/output_simulation_") + to_string(id) + "." + outputFormat;
+	}
+
+	// The log and bin output types are binary files.
+	static ios::openmode openMode(string outputFormat) {
+		return outputFormat == "log" || outputFormat == "bin" ? ios::binary : ios::out;
+	}
+
+	static int IDGenerator;
+	int id;
+
+	// Compression of the output file.
+	Configuration::OutputCompression compression;
+	int level;
+
+	// The open output file while streaming.
+	OutputStream* stream = nullptr;
+	string format;
+};
+
+#endif
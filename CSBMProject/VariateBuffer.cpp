@@ -0,0 +1,163 @@
+#include "VariateBuffer.h"
+
+#include "CpuFeatures.h"
+
+VariateBuffer::VariateBuffer() : uniforms(BUFFER_SIZE), unitExponentials(BUFFER_SIZE) {
+	bool avx2 = cpuSupportsAvx2();
+	uniformKernel = avx2 ? &VariateBuffer::avx2Uniforms : &VariateBuffer::scalarUniforms;
+	exponentialKernel = avx2 ? &VariateBuffer::avx2UnitExponentials : &VariateBuffer::scalarUnitExponentials;
+}
+
+string VariateBuffer::getKernelName() {
+	return cpuSupportsAvx2() ? "AVX2" : "scalar";
+}
+
+void VariateBuffer::scalarUniforms(RandomGenerator& generator, double destination[], int count) {
+	generator.fillUniforms(destination, count);
+}
+
+void VariateBuffer::scalarUnitExponentials(double values[], int count) {
+	for (int i = 0; i < count; i++) {
+		values[i] = -unitIntervalLog(1.0 - values[i]);
+	}
+}
+
+#ifdef CPU_FEATURES_X86
+// Four Philox blocks per iteration, one in each 64-bit lane; every lane holds a 32-bit word of its block, so
+// _mm256_mul_epu32 gives the full 64-bit products of the rounds.
+AVX2_TARGET void VariateBuffer::avx2Uniforms(RandomGenerator& generator, double destination[], int count) {
+	int i = 0;
+
+	while (i < count && generator.outputPosition != RandomGenerator::OUTPUT_SIZE) {
+		destination[i++] = generator.nextUniform();
+	}
+
+	uint64_t blockIndex = (uint64_t(generator.counter[1]) << 32) | generator.counter[0];
+
+	const __m256i lowMask = _mm256_set1_epi64x(0xffffffff);
+	const __m256i multiplier0 = _mm256_set1_epi64x(RandomGenerator::MULTIPLIER_0);
+	const __m256i multiplier1 = _mm256_set1_epi64x(RandomGenerator::MULTIPLIER_1);
+	const __m256i stream0 = _mm256_set1_epi64x(generator.counter[2]);
+	const __m256i stream1 = _mm256_set1_epi64x(generator.counter[3]);
+
+	// Exact conversion of the 53-bit integers to doubles through the 2^84 and 2^52 exponent patterns.
+	const __m256i highExponent = _mm256_set1_epi64x(0x4530000000000000LL);
+	const __m256i lowExponent = _mm256_set1_epi64x(0x4330000000000000LL);
+	const __m256d highBias = _mm256_set1_pd(19342813113834066795298816.0);
+	const __m256d lowBias = _mm256_set1_pd(4503599627370496.0);
+	const __m256d scale = _mm256_set1_pd(1.0 / 9007199254740992.0);
+
+	const int blocksPerIteration = 4;
+
+	while (count - i >= RandomGenerator::OUTPUT_SIZE * blocksPerIteration) {
+		__m256i index = _mm256_add_epi64(_mm256_set1_epi64x((long long)blockIndex), _mm256_setr_epi64x(0, 1, 2, 3));
+
+		__m256i block0 = _mm256_and_si256(index, lowMask);
+		__m256i block1 = _mm256_srli_epi64(index, 32);
+		__m256i block2 = stream0;
+		__m256i block3 = stream1;
+
+		uint32_t roundKey0 = generator.key[0];
+		uint32_t roundKey1 = generator.key[1];
+
+		for (int round = 0; round < RandomGenerator::ROUNDS; round++) {
+			__m256i product0 = _mm256_mul_epu32(multiplier0, block0);
+			__m256i product1 = _mm256_mul_epu32(multiplier1, block2);
+
+			block0 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(product1, 32), block1), _mm256_set1_epi64x(roundKey0));
+			block1 = _mm256_and_si256(product1, lowMask);
+			block2 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(product0, 32), block3), _mm256_set1_epi64x(roundKey1));
+			block3 = _mm256_and_si256(product0, lowMask);
+
+			roundKey0 += RandomGenerator::WEYL_0;
+			roundKey1 += RandomGenerator::WEYL_1;
+		}
+
+		// The top 53 bits of (upper << 32) | lower, split into the upper 21 and the lower 32 bits.
+		__m256i first = _mm256_or_si256(_mm256_slli_epi64(block1, 21), _mm256_srli_epi64(block0, 11));
+		__m256i second = _mm256_or_si256(_mm256_slli_epi64(block3, 21), _mm256_srli_epi64(block2, 11));
+
+		__m256d firstUniforms = _mm256_mul_pd(_mm256_add_pd(
+			_mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(first, 32), highExponent)), highBias),
+			_mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(first, lowMask), lowExponent)), lowBias)), scale);
+		__m256d secondUniforms = _mm256_mul_pd(_mm256_add_pd(
+			_mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(second, 32), highExponent)), highBias),
+			_mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(second, lowMask), lowExponent)), lowBias)), scale);
+
+		// Interleave back into stream order: both outputs of the first block, then of the second, and so on.
+		__m256d lower = _mm256_unpacklo_pd(firstUniforms, secondUniforms);
+		__m256d upper = _mm256_unpackhi_pd(firstUniforms, secondUniforms);
+		_mm256_storeu_pd(destination + i, _mm256_permute2f128_pd(lower, upper, 0x20));
+		_mm256_storeu_pd(destination + i + 4, _mm256_permute2f128_pd(lower, upper, 0x31));
+
+		blockIndex += blocksPerIteration;
+		i += RandomGenerator::OUTPUT_SIZE * blocksPerIteration;
+	}
+
+	generator.counter[0] = uint32_t(blockIndex & 0xffffffff);
+	generator.counter[1] = uint32_t(blockIndex >> 32);
+
+	while (i < count) {
+		destination[i++] = generator.nextUniform();
+	}
+}
+
+// Same operations in the same order as unitIntervalLog, so the results are identical to the scalar kernel.
+AVX2_TARGET void VariateBuffer::avx2UnitExponentials(double values[], int count) {
+	const __m256i lowMask = _mm256_set1_epi64x(0xffffffff);
+	const __m256i mantissaMask = _mm256_set1_epi64x(0x000fffff);
+	const __m256i unitExponent = _mm256_set1_epi64x(0x3ff00000);
+	const __m256i sqrtTwoWord = _mm256_set1_epi64x(0x3ff6a09e);
+	const __m256i one = _mm256_set1_epi64x(1);
+	const __m256i integerExponent = _mm256_set1_epi64x(0x4330000000000000LL);
+	const __m256d integerBias = _mm256_set1_pd(4503599627370496.0);
+
+	const __m256d oneDouble = _mm256_set1_pd(1.0);
+	const __m256d exponentBias = _mm256_set1_pd(1023.0);
+	const __m256d ln2High = _mm256_set1_pd(6.93147180369123816490e-01);
+	const __m256d ln2Low = _mm256_set1_pd(1.90821492927058770002e-10);
+	const __m256d signMask = _mm256_set1_pd(-0.0);
+
+	const double coefficients[] = { 1.0 / 19, 1.0 / 17, 1.0 / 15, 1.0 / 13, 1.0 / 11, 1.0 / 9, 1.0 / 7, 1.0 / 5, 1.0 / 3 };
+
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m256d x = _mm256_sub_pd(oneDouble, _mm256_loadu_pd(values + i));
+		__m256i bits = _mm256_castpd_si256(x);
+
+		__m256i upperWord = _mm256_srli_epi64(bits, 32);
+		__m256i mantissaWord = _mm256_or_si256(_mm256_and_si256(upperWord, mantissaMask), unitExponent);
+		__m256i reduce = _mm256_and_si256(_mm256_cmpgt_epi64(mantissaWord, sqrtTwoWord), one);
+		mantissaWord = _mm256_sub_epi64(mantissaWord, _mm256_slli_epi64(reduce, 20));
+
+		__m256i biasedExponent = _mm256_add_epi64(_mm256_srli_epi64(upperWord, 20), reduce);
+		__m256d exponent = _mm256_sub_pd(_mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(biasedExponent, integerExponent)), integerBias), exponentBias);
+
+		__m256d m = _mm256_castsi256_pd(_mm256_or_si256(_mm256_slli_epi64(mantissaWord, 32), _mm256_and_si256(bits, lowMask)));
+
+		__m256d s = _mm256_div_pd(_mm256_sub_pd(m, oneDouble), _mm256_add_pd(m, oneDouble));
+		__m256d z = _mm256_mul_pd(s, s);
+
+		__m256d series = _mm256_set1_pd(1.0 / 21);
+		for (int k = 0; k < 9; k++) {
+			series = _mm256_add_pd(_mm256_mul_pd(series, z), _mm256_set1_pd(coefficients[k]));
+		}
+
+		__m256d twoS = _mm256_add_pd(s, s);
+		__m256d logarithm = _mm256_add_pd(_mm256_mul_pd(exponent, ln2High),
+			_mm256_add_pd(_mm256_mul_pd(exponent, ln2Low), _mm256_add_pd(_mm256_mul_pd(_mm256_mul_pd(twoS, z), series), twoS)));
+
+		_mm256_storeu_pd(values + i, _mm256_xor_pd(logarithm, signMask));
+	}
+
+	scalarUnitExponentials(values + i, count - i);
+}
+#else
+void VariateBuffer::avx2Uniforms(RandomGenerator& generator, double destination[], int count) {
+	scalarUniforms(generator, destination, count);
+}
+
+void VariateBuffer::avx2UnitExponentials(double values[], int count) {
+	scalarUnitExponentials(values, count);
+}
+#endif
@@ -0,0 +1,139 @@
+#ifndef _VARIATEBUFFER_H_
+
+#define _VARIATEBUFFER_H_
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <string>
+
+#include "RandomGenerator.h"
+
+using namespace std;
+
+// A per-thread buffer of uniforms and unit exponentials for the direct method.
+// The buffer is attached to the random stream of the simulation the thread is running and refills many variates
+// at a time: the uniforms in bulk from the stream and the unit exponentials as -log(1 - U) with the branch-free
+// logarithm below. Both refills run AVX2 kernels when the CPU supports them, which produce the same numbers as the
+// portable ones. Attaching discards what is left of the previous simulation, so the variates of a simulation
+// depend only on its own stream and not on the thread running it. Since most simulations end after a few
+// hundred events, the refills start small and double up to BUFFER_SIZE.
+class VariateBuffer {
+
+public:
+
+	static const int BUFFER_SIZE = 2048;
+	static const int FIRST_REFILL_SIZE = 32;
+
+	// Constructor.
+	VariateBuffer();
+
+	// Binds the buffer to the given random stream.
+	void attach(RandomGenerator& generator) {
+		rng = &generator;
+		uniformPosition = uniformCount = 0;
+		exponentialPosition = exponentialCount = 0;
+	}
+
+	// Returns a uniformly distributed number in [0, 1).
+	double nextUniform() {
+		if (uniformPosition == uniformCount) {
+			uniformCount = nextRefillSize(uniformCount);
+			uniformKernel(*rng, uniforms.data(), uniformCount);
+			uniformPosition = 0;
+		}
+		return uniforms[uniformPosition++];
+	}
+
+	// Returns an exponentially distributed number with rate 1.
+	double nextUnitExponential() {
+		if (exponentialPosition == exponentialCount) {
+			refillUnitExponentials();
+		}
+		return unitExponentials[exponentialPosition++];
+	}
+
+	// Name of the kernels selected for this CPU.
+	static string getKernelName();
+
+	// Natural logarithm of x in (0, 1]. x = m * 2^e with m in [sqrt(2) / 2, sqrt(2)), and log(m) = 2 * atanh(s)
+	// with s = (m - 1) / (m + 1), |s| < 0.1716. The atanh series is cut after the s^21 term, whose remainder is
+	// below 1e-18 relative, so the result is within a few ulp of std::log (at most 2 ulp over [2^-53, 1]).
+	static double unitIntervalLog(double x) {
+		uint64_t bits;
+		memcpy(&bits, &x, sizeof(bits));
+
+		// Mantissas above sqrt(2) are halved by lowering their exponent field. Only the upper word is inspected
+		// (32-bit integer operations), which keeps the reduction free of branches and vectorizable with SSE2.
+		uint32_t upperWord = uint32_t(bits >> 32);
+		uint32_t mantissaWord = (upperWord & 0x000fffff) | 0x3ff00000;
+		uint32_t reduce = mantissaWord > 0x3ff6a09e ? 1 : 0;
+		mantissaWord -= reduce << 20;
+
+		double exponent = (double)((int32_t)(upperWord >> 20) - 1023 + (int32_t)reduce);
+
+		uint64_t mantissaBits = (uint64_t(mantissaWord) << 32) | (bits & 0xffffffffULL);
+		double m;
+		memcpy(&m, &mantissaBits, sizeof(m));
+
+		double s = (m - 1) / (m + 1);
+		double z = s * s;
+
+		double series = 1.0 / 21;
+		series = series * z + 1.0 / 19;
+		series = series * z + 1.0 / 17;
+		series = series * z + 1.0 / 15;
+		series = series * z + 1.0 / 13;
+		series = series * z + 1.0 / 11;
+		series = series * z + 1.0 / 9;
+		series = series * z + 1.0 / 7;
+		series = series * z + 1.0 / 5;
+		series = series * z + 1.0 / 3;
+
+		// ln(2) split into a part exact in 32 bits and the rest, so exponent * LN2_HIGH is exact.
+		const double LN2_HIGH = 6.93147180369123816490e-01;
+		const double LN2_LOW = 1.90821492927058770002e-10;
+
+		double twoS = 2 * s;
+		return exponent * LN2_HIGH + (exponent * LN2_LOW + (twoS * z * series + twoS));
+	}
+
+private:
+
+	static int nextRefillSize(int lastRefillSize) {
+		if (lastRefillSize == 0) {
+			return FIRST_REFILL_SIZE;
+		}
+		return lastRefillSize < BUFFER_SIZE ? 2 * lastRefillSize : BUFFER_SIZE;
+	}
+
+	void refillUnitExponentials() {
+		exponentialCount = nextRefillSize(exponentialCount);
+		uniformKernel(*rng, unitExponentials.data(), exponentialCount);
+		exponentialKernel(unitExponentials.data(), exponentialCount);
+		exponentialPosition = 0;
+	}
+
+	// Refill kernels: fill with the next uniforms of the stream, and turn uniforms into unit exponentials.
+	typedef void (*UniformKernel)(RandomGenerator& generator, double destination[], int count);
+	typedef void (*ExponentialKernel)(double values[], int count);
+
+	static void scalarUniforms(RandomGenerator& generator, double destination[], int count);
+	static void avx2Uniforms(RandomGenerator& generator, double destination[], int count);
+	static void scalarUnitExponentials(double values[], int count);
+	static void avx2UnitExponentials(double values[], int count);
+
+	UniformKernel uniformKernel;
+	ExponentialKernel exponentialKernel;
+
+	RandomGenerator* rng = nullptr;
+
+	vector<double> uniforms;
+	vector<double> unitExponentials;
+	int uniformPosition = 0;
+	int uniformCount = 0;
+	int exponentialPosition = 0;
+	int exponentialCount = 0;
+};
+
+#endif
@@ -1,18 +1,55 @@
 #include <iostream>
 #include <string>
+#include <cstdlib>
+#include <cstdint>
 
 #include "Configuration.h"
 #include "Simulator.h"
+#include "Benchmark.h"
+#include "TrajectoryLog.h"
+#include "SegmentedOutput.h"
 
 using namespace std;
 
-int main() {
+int main(int argc, char* argv[]) {
 
 	const string CONFIG_FILENAME = "config.conf";
 
+	// Decode a trajectory log to CSV on the standard output when asked to (no configuration file needed), either
+	// whole or from a given row on, optionally up to a number of rows.
+	if (argc > 2 && string(argv[1]) == "--decode") {
+		TrajectoryLog trajectoryLog;
+		if (!trajectoryLog.load(argv[2])) {
+			cerr << "ERROR: " << argv[2] << " is not a valid trajectory log." << endl;
+			return 1;
+		}
+		size_t first = argc > 3 ? strtoull(argv[3], nullptr, 10) : 0;
+		size_t last = argc > 4 ? first + strtoull(argv[4], nullptr, 10) : SIZE_MAX;
+		trajectoryLog.outputCSV(cout, first, last);
+		return 0;
+	}
+
+	// Print the trajectory of one simulation of a consolidated output, as it would have been written to a file of its own.
+	if (argc > 2 && string(argv[1]) == "--extract") {
+		string trajectory;
+		if (!SegmentedOutput::readTrajectory(atoi(argv[2]), trajectory)) {
+			cerr << "ERROR: Simulation " << argv[2] << " is not in the index of the consolidated output." << endl;
+			return 1;
+		}
+		cout.write(trajectory.data(), trajectory.size());
+		return 0;
+	}
+
 	// 1) Parse the configuration file and create a Configuration object which holds the parameters for the simulation.
 	Configuration config(CONFIG_FILENAME);
 
+	// Run the benchmarks instead of a simulation when asked to.
+	if (argc > 1 && string(argv[1]) == "--benchmark") {
+		Benchmark benchmark(config);
+		benchmark.run();
+		return 0;
+	}
+
 	// 2) Create the simulator object.
 	Simulator simulator(config);
 